@@ -0,0 +1,77 @@
+#include <bitGrid.h>
+#include <utils.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+// Compares solid-cell probes against the old unordered_set collision map and BitGrid.
+// Worlds are square regions filled to roughly 50% density so probes hit and miss evenly.
+
+using Clock = std::chrono::steady_clock;
+
+static double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main() {
+    constexpr size_t probeCount = 10'000'000;
+    std::mt19937 rng(1234);
+
+    for (size_t solidCount : { 1'000ull, 10'000ull, 100'000ull, 1'000'000ull }) {
+        int side = static_cast<int>(std::sqrt(static_cast<double>(solidCount) * 2.0));
+        std::uniform_int_distribution<int> coord(-side / 2, side / 2);
+
+        std::vector<Int2> cells;
+        cells.reserve(solidCount);
+        std::unordered_set<Int2, Int2::Hash> cellSet;
+        while (cellSet.size() < solidCount) {
+            Int2 cell(coord(rng), coord(rng));
+            if (cellSet.insert(cell).second) cells.push_back(cell);
+        }
+
+        std::vector<Int2> probes(probeCount);
+        for (Int2& probe : probes) probe = Int2(coord(rng), coord(rng));
+
+        auto start = Clock::now();
+        std::unordered_set<Int2, Int2::Hash> set;
+        for (Int2 cell : cells) set.insert(cell);
+        double setInsert = SecondsSince(start);
+
+        start = Clock::now();
+        BitGrid grid;
+        for (Int2 cell : cells) grid.Set(cell);
+        double gridInsert = SecondsSince(start);
+
+        // Stamping a prebuilt level is the path AddLevel takes
+        start = Clock::now();
+        BitGrid stamped;
+        stamped.Stamp(grid, Int2(BITGRID_CHUNK_SIZE * 4, 0));
+        double gridStamp = SecondsSince(start);
+
+        size_t setHits = 0;
+        start = Clock::now();
+        for (Int2 probe : probes) setHits += set.count(probe);
+        double setProbe = SecondsSince(start);
+
+        size_t gridHits = 0;
+        start = Clock::now();
+        for (Int2 probe : probes) gridHits += grid.Test(probe);
+        double gridProbe = SecondsSince(start);
+
+        if (setHits != gridHits) {
+            std::printf("MISMATCH: set found %zu hits, grid found %zu\n", setHits, gridHits);
+            return 1;
+        }
+
+        std::printf("%8zu solid cells | insert: set %8.2f ms, grid %8.2f ms, stamp %6.2f ms | "
+            "probe: set %7.1f M/s, grid %7.1f M/s (%.1fx)\n",
+            solidCount,
+            setInsert * 1000.0, gridInsert * 1000.0, gridStamp * 1000.0,
+            probeCount / setProbe / 1e6, probeCount / gridProbe / 1e6, setProbe / gridProbe);
+    }
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "uiBenchSupport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Lays out a row of thousands of growable labels with uneven measured widths and a column of
+// thousands of growable panels, so the time per child shows whether the grow passes scale
+// linearly. Roomy rows let every label grow, tight ones only have space to even out the
+// shorter labels. The screen size changes every frame to keep the layout cache from
+// skipping the work.
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int FRAME_COUNT = 50;
+constexpr int MAX_LABEL_LENGTH = 32;
+constexpr float FONT_SIZE = 16.0f;
+
+// Every label gets a different length, the worst case for the old pairwise search
+static std::string_view Label(const std::string& text, int i, int childCount) {
+    return std::string_view(text).substr(0, 1 + static_cast<size_t>((i * 7919) % childCount) * MAX_LABEL_LENGTH / childCount);
+}
+
+static void BuildFrame(UIContext& ui, Vec2 screen, UI::FlexDir direction, int childCount, Font& font, const std::string& text) {
+    using namespace UI;
+    ui.BeginUI(screen, MouseState{}); {
+        ui.Panel(PanelStyle{ .sizing = { Grow(), Grow() }, .flexDir = direction }, [&] {
+            for (int i = 0; i < childCount; ++i) {
+                if (direction == FlexDir::ROW) ui.Text(Label(text, i, childCount), { .font = &font, .fontSize = FONT_SIZE });
+                else ui.Panel(PanelStyle{ .sizing = { Fixed(8), Grow() } });
+            }
+        });
+    } ui.EndUI();
+}
+
+// The children have to fill the container exactly, with every child either raised to the
+// shared water level or left at its own size above it
+static bool CheckFill(const UI::Element* container, bool isRow, int childCount, Font& font, const std::string& text) {
+    float total = 0.0f;
+    float level = std::numeric_limits<float>::max();
+    for (const UI::Element* child : container->children()) {
+        float size = isRow ? child->size.x : child->size.y;
+        total += size;
+        level = fminf(level, size);
+    }
+
+    int i = 0;
+    for (const UI::Element* child : container->children()) {
+        float size = isRow ? child->size.x : child->size.y;
+        float fit = isRow ? MeasureText(std::string(Label(text, i, childCount)).c_str(), font, FONT_SIZE).x : 0.0f;
+        if (fabsf(size - fmaxf(fit, level)) > 0.01f) return false;
+        i++;
+    }
+    float available = isRow ? container->size.x : container->size.y;
+    return fabsf(total - available) <= available * 1e-4f;
+}
+
+int main() {
+    Font font = MakeBenchFont();
+    std::string text(MAX_LABEL_LENGTH, 'm');
+    float averageWidth = MeasureText(std::string(MAX_LABEL_LENGTH / 2, 'm').c_str(), font, FONT_SIZE).x;
+
+    for (UI::FlexDir direction : { UI::FlexDir::ROW, UI::FlexDir::COLUMN }) {
+        bool isRow = direction == UI::FlexDir::ROW;
+
+        // Twice the average label width is room for all of them, a quarter over it only for
+        // raising the shorter ones. Columns of panels start even, so only the roomy case runs.
+        for (float perChild : { 2.0f * averageWidth, 1.25f * averageWidth }) {
+            bool isRoomy = perChild > 1.5f * averageWidth;
+            if (!isRow && !isRoomy) continue;
+            const char* name = !isRow ? "Column" : isRoomy ? "Row, roomy" : "Row, tight";
+            std::printf("%s\n", name);
+
+            for (int childCount : { 1'000, 2'000, 4'000, 8'000, 16'000 }) {
+                UIContext ui;
+                bool filled = true;
+
+                auto start = Clock::now();
+                for (int frame = 0; frame < FRAME_COUNT; ++frame) {
+                    float along = childCount * perChild + static_cast<float>(frame % 2);
+                    Vec2 screen = isRow ? Vec2(along, 600.0f) : Vec2(800.0f, along);
+                    BuildFrame(ui, screen, direction, childCount, font, text);
+                    if (frame == 0 || frame == FRAME_COUNT - 1) filled = filled && CheckFill(ui.root->firstChild, isRow, childCount, font, text);
+                }
+                double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+                std::printf("  %6d children | %8.3f ms/frame | %6.1f ns/child | %s\n", childCount,
+                    seconds * 1000.0 / FRAME_COUNT, seconds * 1e9 / FRAME_COUNT / childCount, filled ? "filled" : "NOT FILLED");
+                if (!filled) return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <levels.h>
+#include <levelCache.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Times loading the levels in res/ by parsing the .tmx against loading the compiled cache.
+// Run from the repository root after levelCompiler, or pass the resource directory as the
+// first argument.
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int LOAD_COUNT = 200;
+
+int main(int argc, char** argv) {
+    std::string resDir = argc > 1 ? argv[1] : "res/";
+    if (resDir.back() != '/') resDir += '/';
+
+    for (const char* name : { "tilemap.tmx", "testLevel.tmx" }) {
+        std::string tmxFile = resDir + name;
+        std::string cacheFile = LevelCachePath(tmxFile.c_str());
+
+        auto parseStart = Clock::now();
+        for (int i = 0; i < LOAD_COUNT; ++i) {
+            tmx::Map map;
+            if (!map.load(tmxFile)) {
+                std::printf("Failed to load %s\n", tmxFile.c_str());
+                return 1;
+            }
+            Level level;
+            LoadLevel(map, level);
+        }
+        double parseSeconds = std::chrono::duration<double>(Clock::now() - parseStart).count();
+
+        auto cacheStart = Clock::now();
+        for (int i = 0; i < LOAD_COUNT; ++i) {
+            Level* level = LoadLevelCache(cacheFile.c_str(), tmxFile.c_str());
+            if (level == nullptr) {
+                std::printf("%s is missing or stale, run levelCompiler first\n", cacheFile.c_str());
+                return 1;
+            }
+            delete level;
+        }
+        double cacheSeconds = std::chrono::duration<double>(Clock::now() - cacheStart).count();
+
+        std::printf("%-14s | tmx %8.3f ms | cache %8.3f ms | %6.1fx\n", name,
+            parseSeconds * 1000.0 / LOAD_COUNT, cacheSeconds * 1000.0 / LOAD_COUNT, parseSeconds / cacheSeconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <gameState.h>
+#include <levels.h>
+#include <moveHistory.h>
+#include <replay.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Records a corpus of random sessions on the levels in res/, then replays them headless and
+// checks every one ends on the recorded checksum. Run from the repository root, or pass the
+// resource directory as the first argument.
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int REPLAY_COUNT = 64;
+constexpr int MOVES_PER_REPLAY = 20'000;
+
+static const Int2 directions[4] = { Int2::up, Int2::down, Int2::left, Int2::right };
+
+// Plays a session the way the game would: held keys, the odd undo burst, one drafted level
+static bool RecordSession(const std::string& resDir, uint32_t seed, Replay& replay) {
+    std::string baseMapPath = resDir + "tilemap.tmx";
+    std::string levelPath = resDir + "testLevel.tmx";
+    Level* baseMap = LoadLevel(baseMapPath.c_str(), Int2::down);
+    Level* level = LoadLevel(levelPath.c_str(), Int2::up);
+    if (baseMap == nullptr || level == nullptr) {
+        std::printf("Failed to load %s\n", baseMap == nullptr ? baseMapPath.c_str() : levelPath.c_str());
+        delete baseMap;
+        delete level;
+        return false;
+    }
+
+    GameState state;
+    state.AddLevel(*baseMap, Int2::zero);
+    MoveHistory history;
+    history.Reset(state);
+
+    ReplayRecorder recorder;
+    recorder.Begin(baseMapPath, state.playerPos);
+
+    std::mt19937 rng(seed);
+    uint32_t step = 0;
+    for (int i = 0; i < MOVES_PER_REPLAY; ++i) {
+        if (i == MOVES_PER_REPLAY / 4) {
+            state.AddLevel(*level, Int2(16, 0));
+            history.Reset(state);
+            recorder.RecordAddLevel(step, levelPath, Int2(16, 0));
+        }
+
+        uint32_t roll = rng() % 100;
+        if (roll < 4) {
+            for (uint32_t n = rng() % 8; n > 0; --n) {
+                if (history.Undo(state)) recorder.RecordUndo(step);
+            }
+        }
+        else if (roll < 6) {
+            if (history.Redo(state)) recorder.RecordRedo(step);
+        }
+        else {
+            Int2 direction = directions[rng() % 4];
+            MoveResult result = state.Move(direction);
+            recorder.RecordMove(step, direction, result.moved);
+            if (result.moved) history.Record(state, result);
+        }
+        // A move animates for 60 simulation steps at 240 Hz
+        step += 60;
+    }
+
+    replay = recorder.Finish(state);
+    delete baseMap;
+    delete level;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string resDir = argc > 1 ? argv[1] : "res/";
+    if (resDir.back() != '/') resDir += '/';
+
+    std::vector<Replay> corpus(REPLAY_COUNT);
+    size_t eventCount = 0;
+    auto recordStart = Clock::now();
+    for (int i = 0; i < REPLAY_COUNT; ++i) {
+        if (!RecordSession(resDir, 1234u + i, corpus[i])) return 1;
+        eventCount += corpus[i].events.size();
+    }
+    double recordSeconds = std::chrono::duration<double>(Clock::now() - recordStart).count();
+    std::printf("Recorded %d replays, %zu events in %.2f ms\n", REPLAY_COUNT, eventCount, recordSeconds * 1000.0);
+
+    // The runner keeps its levels between replays, so the first pass also pays for loading
+    ReplayRunner runner;
+    for (int pass = 0; pass < 2; ++pass) {
+        size_t moves = 0, mismatches = 0;
+        auto start = Clock::now();
+        for (const Replay& replay : corpus) {
+            PlaybackResult result;
+            if (!runner.Run(replay, result)) return 1;
+            moves += result.movesApplied;
+            if (!result.checksumMatches || result.divergences > 0) mismatches++;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("Pass %d | %9zu moves | %8.2f ms | %7.2f M moves/s | %zu mismatched\n",
+            pass + 1, moves, seconds * 1000.0, moves / seconds / 1e6, mismatches);
+        if (mismatches > 0) return 1;
+    }
+
+    bool roundTrip = true;
+    auto ioStart = Clock::now();
+    for (const Replay& replay : corpus) {
+        const char* filename = "replayBench.skr";
+        Replay loaded;
+        if (!SaveReplay(replay, filename) || !LoadReplay(filename, loaded)) return 1;
+        roundTrip &= loaded.events.size() == replay.events.size() && loaded.finalChecksum == replay.finalChecksum;
+    }
+    double ioSeconds = std::chrono::duration<double>(Clock::now() - ioStart).count();
+    std::remove("replayBench.skr");
+    std::printf("Save and load round trip: %.2f ms for %d files (%s)\n", ioSeconds * 1000.0, REPLAY_COUNT,
+        roundTrip ? "ok" : "MISMATCH");
+
+    return roundTrip ? 0 : 1;
+}
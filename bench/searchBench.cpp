@@ -0,0 +1,92 @@
+#include <gameState.h>
+#include <levels.h>
+#include <solver.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Explores every reachable box configuration of the levels in res/ with 1 to N threads.
+// Run from the repository root, or pass the resource directory as the first argument.
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchWorld {
+    const char* name;
+    GameState state;
+};
+
+// First open cell found scanning outward from the origin, where the game spawns the player
+static Int2 FindStart(const GameState& state) {
+    for (int radius = 0; radius < 64; ++radius) {
+        for (int y = -radius; y <= radius; ++y) {
+            for (int x = -radius; x <= radius; ++x) {
+                Int2 cell(x, y);
+                if (!state.IsSolid(cell) && !state.HasBox(cell)) return cell;
+            }
+        }
+    }
+    return Int2::zero;
+}
+
+static bool AddLevelFile(GameState& state, const std::string& path, Int2 position, Int2 objectOffset) {
+    Level* level = LoadLevel(path.c_str(), objectOffset);
+    if (level == nullptr) {
+        std::printf("Failed to load %s\n", path.c_str());
+        return false;
+    }
+    state.AddLevel(*level, position);
+    delete level;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string resDir = argc > 1 ? argv[1] : "res/";
+    if (resDir.back() != '/') resDir += '/';
+
+    std::vector<BenchWorld> worlds(3);
+    worlds[0].name = "tilemap.tmx";
+    worlds[1].name = "testLevel.tmx";
+    worlds[2].name = "tilemap.tmx + testLevel.tmx";
+    // Mirrors the game: the base map keeps its old object offset, drafted levels use the default
+    if (!AddLevelFile(worlds[0].state, resDir + "tilemap.tmx", Int2::zero, Int2::down)) return 1;
+    if (!AddLevelFile(worlds[1].state, resDir + "testLevel.tmx", Int2::zero, Int2::up)) return 1;
+    if (!AddLevelFile(worlds[2].state, resDir + "tilemap.tmx", Int2::zero, Int2::down)) return 1;
+    if (!AddLevelFile(worlds[2].state, resDir + "testLevel.tmx", Int2(16, 0), Int2::up)) return 1;
+
+    // Powers of two below the core count, then the core count itself
+    int maxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (BenchWorld& world : worlds) {
+        world.state.playerPos = FindStart(world.state);
+
+        ExploreOptions options;
+        options.stopAtSolution = false;
+        options.maxStates = 250'000;
+        options.searchMargin = 2;
+
+        std::printf("%s: %zu boxes, player at (%d, %d)\n", world.name, world.state.gameObjects.boxes.Size(),
+            world.state.playerPos.x, world.state.playerPos.y);
+
+        double baseRate = 0.0;
+        for (int threads : threadCounts) {
+            options.threadCount = threads;
+            auto start = Clock::now();
+            ExploreResult result = ExploreReachable(world.state, options);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            double rate = result.statesVisited / seconds;
+            if (threads == 1) baseRate = rate;
+            std::printf("  %2d threads | %9zu states%s | %8.2f ms | %7.2f M states/s (%.2fx) | %zu steals\n",
+                threads, result.statesVisited, result.status == SolveStatus::LimitReached ? " (capped)" : "",
+                seconds * 1000.0, rate / 1e6, rate / baseRate, result.steals);
+        }
+    }
+
+    return 0;
+}
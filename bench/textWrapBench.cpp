@@ -0,0 +1,87 @@
+#include "uiBenchSupport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Lays out a column of long multi-paragraph labels that wrap, three ways: a fresh context
+// every frame so every label is measured and broken from scratch, a window being resized
+// so the measured words are reused but the lines are broken again, and a static panel next
+// to a label that changes every frame, where nothing about the paragraphs is redone.
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int FRAME_COUNT = 200;
+constexpr int PARAGRAPH_COUNT = 40;
+constexpr int WORDS_PER_PARAGRAPH = 120;
+constexpr float FONT_SIZE = 18.0f;
+
+// Paragraphs of random lowercase words, a few of them with hard line breaks inside
+static std::vector<std::string> MakeParagraphs() {
+    std::mt19937 rng(1234);
+    std::vector<std::string> paragraphs(PARAGRAPH_COUNT);
+    for (std::string& paragraph : paragraphs) {
+        for (int i = 0; i < WORDS_PER_PARAGRAPH; ++i) {
+            int length = 1 + static_cast<int>(rng() % 10);
+            for (int c = 0; c < length; ++c) paragraph += static_cast<char>('a' + rng() % 26);
+            paragraph += rng() % 40 == 0 ? '\n' : ' ';
+        }
+    }
+    return paragraphs;
+}
+
+static void BuildFrame(UIContext& ui, float width, int counter, Font& font, const std::vector<std::string>& paragraphs) {
+    using namespace UI;
+    ui.BeginUI(Vec2(width + 200.0f, 1080.0f), MouseState{}, FlexDir::COLUMN); {
+        ui.Text(std::to_string(counter), { .font = &font, .fontSize = FONT_SIZE });
+        ui.Panel(PanelStyle{ .sizing = { Fixed(width), Fit() }, .flexDir = FlexDir::COLUMN, .childGap = 12 }, [&] {
+            for (const std::string& paragraph : paragraphs) ui.Text(paragraph, { .font = &font, .fontSize = FONT_SIZE });
+        });
+    } ui.EndUI();
+}
+
+static size_t CountLines(const UIContext& ui) {
+    size_t lines = 0;
+    for (const UI::Element* paragraph : ui.root->firstChild->nextSibling->children()) {
+        lines += paragraph->isWrapped ? paragraph->cache->lines.size() : 1;
+    }
+    return lines;
+}
+
+int main() {
+    Font font = MakeBenchFont();
+    std::vector<std::string> paragraphs = MakeParagraphs();
+    size_t characterCount = 0;
+    for (const std::string& paragraph : paragraphs) characterCount += paragraph.size();
+    std::printf("%d paragraphs, %zu characters\n", PARAGRAPH_COUNT, characterCount);
+
+    auto run = [&](const char* name, auto&& frame) {
+        size_t lines = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < FRAME_COUNT; ++i) lines = frame(i);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("  %-28s | %8.3f ms/frame | %5zu lines\n", name, seconds * 1000.0 / FRAME_COUNT, lines);
+    };
+
+    run("Measured and broken", [&](int i) {
+        UIContext ui;
+        BuildFrame(ui, 600.0f, i, font, paragraphs);
+        return CountLines(ui);
+    });
+
+    UIContext resized;
+    run("Resized, words cached", [&](int i) {
+        BuildFrame(resized, i % 2 == 0 ? 600.0f : 640.0f, i, font, paragraphs);
+        return CountLines(resized);
+    });
+
+    UIContext settled;
+    run("Static, lines cached", [&](int i) {
+        BuildFrame(settled, 600.0f, i, font, paragraphs);
+        return CountLines(settled);
+    });
+    std::printf("  %u of %u nodes laid out in the last static frame\n", settled.relayoutCount, settled.elementCount);
+
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <ui.h>
+
+// Shared by the UI benchmarks, each of which is a single translation unit. The renderer is
+// linked in for the UI's draw calls and expects the game's globals, none of it runs without
+// a window.
+glm::mat4 projection;
+Int2 screenSize;
+
+// Stands in for a rasterized font, only the advances matter to layout
+inline Font MakeBenchFont() {
+    Font font;
+    for (int c = ASCII_BEGIN; c < ASCII_END; ++c) font.characters[c].advance = (20 + c % 7) << 6;
+    font.lineHeight = 24.0f;
+    return font;
+}
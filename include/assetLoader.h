@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <utils.h>
+#include <levels.h>
+#include <renderer.h>
+#include <text.h>
+
+enum class AssetState : uint8_t {
+    Pending,
+    Ready,
+    Failed,
+};
+
+// Shared handle to an asset loading in the background. Poll Ready() from the frame loop,
+// Get() returns the asset once it is ready and it lives as long as any handle to it.
+template<typename T>
+class AssetHandle {
+public:
+    AssetHandle() = default;
+
+    inline bool Valid() const { return slot != nullptr; }
+    inline AssetState State() const {
+        return slot != nullptr ? slot->state.load(std::memory_order_acquire) : AssetState::Failed;
+    }
+    inline bool Ready() const { return State() == AssetState::Ready; }
+    inline bool Failed() const { return State() == AssetState::Failed; }
+    inline T* Get() const { return Ready() ? &slot->value : nullptr; }
+
+private:
+    friend class AssetLoader;
+
+    struct Slot {
+        std::atomic<AssetState> state = AssetState::Pending;
+        T value{};
+    };
+    std::shared_ptr<Slot> slot;
+};
+
+// Loads levels, textures and fonts as jobs on worker threads. Parsing, image decoding and
+// glyph rasterization run on the workers; anything that needs GL is queued back and done by
+// Update on the GL thread, so the frame loop only ever pays for the uploads.
+class AssetLoader {
+public:
+    // 0 uses one worker per core beyond the one running the game
+    explicit AssetLoader(unsigned threadCount = 0);
+    // Finishes the job each worker is running and drops the rest
+    ~AssetLoader();
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    AssetHandle<Level> LoadLevel(const char* path, Int2 objectOffset = Int2::up);
+    AssetHandle<Texture> LoadTexture(const char* path);
+    AssetHandle<Font> LoadFont(const char* path);
+
+    // GL thread only. Uploads whatever the workers have finished and marks it ready.
+    void Update();
+    // GL thread only. Blocks, uploading as jobs finish, until nothing is left loading.
+    void WaitAll();
+    // Assets requested but not yet ready or failed
+    inline size_t Pending() const { return pending.load(std::memory_order_acquire); }
+
+private:
+    using Job = std::function<void()>;
+
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;
+    bool stopping = false;
+
+    // Finished CPU work waiting for the GL thread
+    std::mutex uploadMutex;
+    std::condition_variable uploadReady;
+    std::vector<Job> uploads;
+    std::vector<Job> uploadScratch;
+
+    std::atomic<size_t> pending = 0;
+
+    void Submit(Job job);
+    void QueueUpload(Job upload);
+    void WorkerLoop();
+
+    // Called from either side. Taking the upload lock keeps WaitAll from missing the wakeup.
+    template<typename T>
+    void Finish(typename AssetHandle<T>::Slot& slot, bool loaded) {
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            slot.state.store(loaded ? AssetState::Ready : AssetState::Failed, std::memory_order_release);
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        uploadReady.notify_all();
+    }
+};
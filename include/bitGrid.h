@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+#include <utils.h>
+#include <chunkIndex.h>
+
+// Matches the chunk size Tiled writes for infinite maps
+constexpr int BITGRID_CHUNK_SHIFT = 4;
+constexpr int BITGRID_CHUNK_SIZE = 1 << BITGRID_CHUNK_SHIFT;
+constexpr int BITGRID_CHUNK_MASK = BITGRID_CHUNK_SIZE - 1;
+
+// Set of cells on the unbounded tile grid, stored as one 16x16 bitmask per chunk.
+// Bit x of rows[y] is the cell at local position (x, y) within the chunk.
+class BitGrid {
+public:
+    using Row = uint16_t;
+
+    struct Chunk {
+        Int2 coord;
+        std::array<Row, BITGRID_CHUNK_SIZE> rows{};
+    };
+
+    static inline Int2 ChunkCoord(Int2 cell) {
+        return Int2(cell.x >> BITGRID_CHUNK_SHIFT, cell.y >> BITGRID_CHUNK_SHIFT);
+    }
+
+    inline bool Test(Int2 cell) const {
+        int32_t slot = index.Find(ChunkCoord(cell));
+        if (slot == ChunkIndex::NONE) return false;
+        return (chunks[slot].rows[cell.y & BITGRID_CHUNK_MASK] >> (cell.x & BITGRID_CHUNK_MASK)) & 1;
+    }
+
+    void Set(Int2 cell);
+    void Reset(Int2 cell);
+    // ORs every cell of other, translated by offset, into this grid a row word at a time
+    void Stamp(const BitGrid& other, Int2 offset);
+    // ORs a whole chunk in at its own coordinate, for loading saved grids
+    void AddChunk(const Chunk& chunk);
+    void Clear();
+
+    size_t Count() const;
+    bool Empty() const { return Count() == 0; }
+
+    const std::vector<Chunk>& Chunks() const { return chunks; }
+    const Chunk* GetChunk(Int2 chunkCoord) const;
+
+private:
+    std::vector<Chunk> chunks;
+    ChunkIndex index;
+
+    Chunk& GetOrAddChunk(Int2 chunkCoord);
+};
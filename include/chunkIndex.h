@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include <utils.h>
+
+// Dense lookup table from chunk coordinates to slot indices. The table covers the
+// bounding box of every chunk inserted so far and grows (re-centering as needed)
+// when a chunk lands outside of it, so lookups are a bounds check and an array index.
+class ChunkIndex {
+public:
+    static constexpr int32_t NONE = -1;
+
+    int32_t Find(Int2 chunkCoord) const {
+        int x = chunkCoord.x - origin.x;
+        int y = chunkCoord.y - origin.y;
+        if (x < 0 || y < 0 || x >= extent.x || y >= extent.y) return NONE;
+        return slots[(size_t)x + (size_t)y * extent.x];
+    }
+
+    void Insert(Int2 chunkCoord, int32_t slot) {
+        Reserve(chunkCoord);
+        int x = chunkCoord.x - origin.x;
+        int y = chunkCoord.y - origin.y;
+        slots[(size_t)x + (size_t)y * extent.x] = slot;
+    }
+
+    void Clear() {
+        origin = Int2::zero;
+        extent = Int2::zero;
+        slots.clear();
+    }
+
+    Int2 Origin() const { return origin; }
+    Int2 Extent() const { return extent; }
+
+private:
+    Int2 origin = Int2::zero;
+    Int2 extent = Int2::zero;
+    std::vector<int32_t> slots;
+
+    void Reserve(Int2 chunkCoord) {
+        if (extent.x == 0 || extent.y == 0) {
+            origin = chunkCoord;
+            extent = Int2::one;
+            slots.assign(1, NONE);
+            return;
+        }
+
+        Int2 newMin = Int2(std::min(origin.x, chunkCoord.x), std::min(origin.y, chunkCoord.y));
+        Int2 newMax = Int2(std::max(origin.x + extent.x, chunkCoord.x + 1), std::max(origin.y + extent.y, chunkCoord.y + 1));
+        if (newMin == origin && newMax.x == origin.x + extent.x && newMax.y == origin.y + extent.y) return;
+
+        // Grow by at least double along each axis that needs it so drafting rooms
+        // outward one at a time stays amortized O(1) per insertion
+        Int2 newExtent = Int2(newMax.x - newMin.x, newMax.y - newMin.y);
+        if (newExtent.x > extent.x) newExtent.x = std::max(newExtent.x, extent.x * 2);
+        if (newExtent.y > extent.y) newExtent.y = std::max(newExtent.y, extent.y * 2);
+        if (newMin.x < origin.x) newMin.x = newMax.x - newExtent.x;
+        if (newMin.y < origin.y) newMin.y = newMax.y - newExtent.y;
+
+        std::vector<int32_t> newSlots((size_t)newExtent.x * newExtent.y, NONE);
+        for (int y = 0; y < extent.y; ++y) {
+            for (int x = 0; x < extent.x; ++x) {
+                int nx = x + origin.x - newMin.x;
+                int ny = y + origin.y - newMin.y;
+                newSlots[(size_t)nx + (size_t)ny * newExtent.x] = slots[(size_t)x + (size_t)y * extent.x];
+            }
+        }
+
+        origin = newMin;
+        extent = newExtent;
+        slots = std::move(newSlots);
+    }
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <vector>
 #include <array>
 #include <unordered_map>
@@ -7,11 +8,11 @@
 
 #include <tiles.h>
 #include <utils.h>
-
-class Tilemap;
+#include <bitGrid.h>
 
 enum class ObjectType {
     Box,
+    Goal,
     Unknown
 };
 
@@ -25,27 +26,69 @@ struct ObjectData {
     bool visible = false;
 };
 
-struct Pushable {
-    Int2 moveDelta = Int2::zero;
-    float move_t = 0.0f;
-    bool isMoving = false;
-};
+// Pushable objects stored as parallel arrays indexed by a dense ID. IDs are handed out in
+// the order objects are added and never change, so a push rewrites one slot of each array
+// and one grid cell instead of re-keying map nodes, and animating every object is a
+// linear pass over contiguous memory.
+class Pushables {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // An object added onto an occupied cell replaces the one there and takes over its ID
+    uint32_t Add(const ObjectData& object);
+    inline uint32_t Find(Int2 cell) const {
+        int32_t slot = index.Find(BitGrid::ChunkCoord(cell));
+        if (slot == ChunkIndex::NONE) return NONE;
+        return chunks[slot][CellSlot(cell)];
+    }
+    inline bool Has(Int2 cell) const { return Find(cell) != NONE; }
+    // Moves the object onto an empty cell with no rule checks or animation
+    void Move(uint32_t id, Int2 to);
+    // Snaps the object to its cell, for changes that should not animate
+    void StopMoving(uint32_t id);
+    // Snaps whatever the previous chain left moving and starts an empty one
+    void StartPushChain();
+    void Clear();
 
-struct Box {
-    uint32_t ID = 0;
-    Pushable pushData = {};
+    inline size_t Size() const { return position.size(); }
 
-    Box() : ID(0) {}
-    Box(uint32_t initID) : ID(initID) {}
+    std::vector<Int2> position;
+    // Drawn offset from the cell, in pixels
+    std::vector<Vec2> offset;
+    std::vector<Int2> moveDelta;
+    std::vector<float> move_t;
+    std::vector<uint8_t> isMoving;
+    // IDs pushed by the last move, far end of the chain first. The animation walks only
+    // these, and the vector is reused so it stops allocating once it has held the longest
+    // chain. Entries snapped by StopMoving stay in it and are skipped.
+    std::vector<uint32_t> pushChain;
+    // Tile, size and visibility, only read when drawing. Its position and offset are not
+    // kept up to date, use the arrays above.
+    std::vector<ObjectData> drawData;
+
+private:
+    // Cell to ID, one block of IDs per chunk found through the same index BitGrid uses
+    using Chunk = std::array<uint32_t, BITGRID_CHUNK_SIZE * BITGRID_CHUNK_SIZE>;
+    std::vector<Chunk> chunks;
+    ChunkIndex index;
+
+    static inline size_t CellSlot(Int2 cell) {
+        return (size_t)(cell.x & BITGRID_CHUNK_MASK) + (size_t)(cell.y & BITGRID_CHUNK_MASK) * BITGRID_CHUNK_SIZE;
+    }
+    uint32_t& GetOrAddCell(Int2 cell);
 };
 
 struct GameObjects {
-    std::unordered_map<Int2, Box, Int2::Hash> boxes;
+    Pushables boxes;
 };
 
 ObjectType stringToObjectType(const std::string& str);
-void Push(Pushable& pushable, Int2 direction);
-void UpdatePushable(Tilemap& world, Pushable& pushable, ObjectData& object, float tick_t);
+// Starts the push animation and appends the object to the current push chain
+void Push(Pushables& pushables, uint32_t id, Int2 direction);
+// Pushes are applied to the game state straight away, these only animate the drawn offset
+// from the previous cell into the new one
+void UpdatePushables(Pushables& pushables, float tick_t);
+void AnimatePushables(Pushables& pushables, float t);
 static inline bool isPushable(ObjectType objType) {
     switch (objType) {
     case ObjectType::Box: return true;
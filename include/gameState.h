@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <utils.h>
+#include <bitGrid.h>
+#include <gameObjects.h>
+#include <levels.h>
+
+// Outcome of a single player step. Pushed boxes always form one contiguous chain
+// directly in front of the player, so the chain is described by its length.
+struct MoveResult {
+    bool moved = false;
+    Int2 direction = Int2::zero;
+    // Player position after the move, the pushed boxes now sit at to + direction * 1..pushCount
+    Int2 to = Int2::zero;
+    uint32_t pushCount = 0;
+    // Set when the push was refused because it would leave a box stuck off a goal
+    bool deadlock = false;
+};
+
+// The Sokoban rules and everything they read or write, with no rendering attached.
+// Moves take effect immediately, animation is left to whoever draws the state.
+class GameState {
+public:
+    Int2 playerPos = Int2::zero;
+    BitGrid collisionMap;
+    // Goals can sit under boxes, so they are kept apart from the pushable store
+    BitGrid goals;
+    // Floor cells a box can never be pushed from onto a goal. Cells outside every stamped
+    // room are open floor and never dead.
+    BitGrid deadSquares;
+    // Refuse pushes that would deadlock a box, only while the world has goals to reach
+    bool blockDeadlockPushes = true;
+    GameObjects gameObjects;
+
+    inline bool IsSolid(Int2 pos) const { return collisionMap.Test(pos); }
+    inline bool HasBox(Int2 pos) const { return gameObjects.boxes.Has(pos); }
+    inline bool IsGoal(Int2 pos) const { return goals.Test(pos); }
+    inline bool IsDeadSquare(Int2 pos) const { return deadSquares.Test(pos); }
+    // Whether a box leaving from and landing on to ends up on a dead square or frozen off a
+    // goal against walls and other boxes. A push chain counts as its first box landing on
+    // the far end, since the cells in between stay occupied.
+    bool IsDeadlockPush(Int2 from, Int2 to) const;
+    // True once every box rests on a goal
+    bool IsSolved() const;
+
+    MoveResult Move(Int2 direction);
+
+    void AddGameObject(ObjectData objectData);
+    void AddLevel(const Level& level, Int2 position);
+
+    // Moves the box at from onto to with no rule checks or animation, for restoring saved states
+    void MoveBox(Int2 from, Int2 to);
+
+private:
+    // Recomputes dead squares inside the rectangle and revives any outside cell that can
+    // now reach it. Cells outside only ever turn from dead to live, so a new wall elsewhere
+    // can leave a cell marked live that is really dead, never the other way around.
+    void UpdateDeadSquares(Int2 regionMin, Int2 regionMax);
+};
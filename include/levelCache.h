@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+#include <utils.h>
+#include <levels.h>
+
+// Compiled levels hold everything LoadLevel builds from a .tmx (tile chunks, the collision
+// bitmap, objects and tileset references) as fixed size records, so loading one is a
+// memory map and a few copies instead of an XML, base64 and zlib pass. They are written
+// offline by the levelCompiler tool and sit next to the map they were built from.
+
+// res/level.tmx -> res/level.lvl
+std::string LevelCachePath(const char* tmxFile);
+
+// Level must have been parsed with a zero object offset. Records the size and write time
+// of tmxFile so the cache can tell when it is out of date.
+bool WriteLevelCache(const Level& level, const char* tmxFile, const char* cacheFile);
+
+// Returns nullptr when the cache is missing, malformed, or older than tmxFile. A cache whose
+// .tmx is gone is still used, so builds can ship compiled levels alone. Changes to an
+// external .tsx are not tracked, recompile after editing one.
+Level* LoadLevelCache(const char* cacheFile, const char* tmxFile, Int2 objectOffset = Int2::up);
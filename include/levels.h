@@ -3,8 +3,10 @@
 #include <tiles.h>
 #include <utils.h>
 #include <gameObjects.h>
+#include <bitGrid.h>
 
-#include <unordered_set>
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 enum class LevelExits {
@@ -19,14 +21,44 @@ inline LevelExits operator|(LevelExits a, LevelExits b) {
     return static_cast<LevelExits>(static_cast<int>(a) | static_cast<int>(b));
 }
 
+// What drawing needs from a tileset, copied out of tmxlite so a compiled level can carry it
+// without the .tsx
+struct TilesetInfo {
+    uint32_t firstGID = 0;
+    uint32_t lastGID = 0;
+    uint32_t tileCount = 0;
+    uint32_t columns = 0;
+    Int2 imageSize = Int2::zero;
+    std::string imagePath;
+    // Bit i is set when tmx::Tileset::getTile(i) returns a tile
+    std::vector<uint32_t> tileMask;
+
+    inline bool HasTile(uint32_t i) const {
+        return (size_t)(i >> 5) < tileMask.size() && (tileMask[i >> 5] >> (i & 31)) & 1;
+    }
+};
+
 struct Level {
     std::vector<ChunkLayer> layers;
-    std::unordered_set<Int2, Int2::Hash> collisionMap;
+    BitGrid collisionMap;
     std::vector<ObjectData> objects;
 
     Int2 size = Int2::zero;
+    Int2 tileSize = Int2::zero;
+    std::vector<TilesetInfo> tilesets;
 
     LevelExits exits = LevelExits::None;
 };
 
-Level* LoadLevel(const char* filename);
+// Tile objects are anchored at their bottom-left corner in Tiled, objectOffset moves them onto
+// the cell they cover. The base tilemap has always used Int2::down here, levels Int2::up.
+// Loads the compiled cache next to the file when it is up to date, the .tmx otherwise.
+Level* LoadLevel(const char* filename, Int2 objectOffset = Int2::up);
+void LoadLevel(const tmx::Map& map, Level& level, Int2 objectOffset = Int2::up);
+
+// Whether the level's layers can be stamped onto layers at position: the layer counts match,
+// every layer lands on the chunk grid with chunks of the same size, and no chunk overlaps one
+// already placed. The game and headless replays both go through this so they agree.
+bool CanPlaceLevel(const std::vector<ChunkLayer>& layers, const Level& level, Int2 position);
+// Adds the level's chunks to layers moved by position, check CanPlaceLevel first
+void StampLevelLayers(std::vector<ChunkLayer>& layers, const Level& level, Int2 position);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+// Read only view of a whole file mapped into memory. Pages are read in by the OS on first
+// touch, so opening is cheap and untouched parts of the file are never read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* filename);
+    void Close();
+
+    inline const uint8_t* Data() const { return data; }
+    inline size_t Size() const { return size; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
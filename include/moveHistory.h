@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <utils.h>
+#include <gameState.h>
+#include <packedState.h>
+
+// Undo/redo over a ring of per move deltas. A delta is the step direction and how many
+// boxes the step pushed, which is enough to run the move either way, so undoing n moves
+// costs n small updates. A packed snapshot every snapshotInterval moves lets Seek jump
+// long distances by restoring the nearest snapshot and replaying the rest.
+class MoveHistory {
+public:
+    explicit MoveHistory(size_t capacity = 4096, size_t snapshotInterval = 64);
+
+    // Starts an empty history at the state as it is now. Call again whenever the world
+    // changes outside of Move, such as when a level is stamped in.
+    void Reset(const GameState& state);
+    // Call with the state after the move. Drops any redo moves past the current position.
+    // A move pushing more than MAX_PUSH_COUNT boxes can't be stored and resets the history.
+    void Record(const GameState& state, const MoveResult& move);
+
+    bool Undo(GameState& state);
+    bool Redo(GameState& state);
+    // Takes the state to an absolute move number between Oldest() and Newest()
+    bool Seek(GameState& state, size_t position);
+
+    inline bool CanUndo() const { return cursor > 0; }
+    inline bool CanRedo() const { return cursor < count; }
+    // Absolute move numbers, the oldest one moves forward once the ring is full
+    inline size_t Position() const { return base + cursor; }
+    inline size_t Oldest() const { return base; }
+    inline size_t Newest() const { return base + count; }
+
+private:
+    // Direction index in the low 2 bits, push count above it
+    using Delta = uint16_t;
+    static constexpr uint32_t MAX_PUSH_COUNT = 0xFFFF >> 2;
+
+    struct Snapshot {
+        size_t position = 0;
+        bool valid = false;
+        PackedState state;
+    };
+
+    std::vector<Delta> deltas;
+    size_t head = 0;
+    size_t count = 0;
+    size_t cursor = 0;
+    size_t base = 0;
+
+    size_t snapshotInterval;
+    PackedLayout layout;
+    std::vector<Snapshot> snapshots;
+
+    Delta& DeltaAt(size_t offset) { return deltas[(head + offset) % deltas.size()]; }
+    void TakeSnapshot(const GameState& state);
+    const Snapshot* FindSnapshot(size_t position) const;
+    static void Apply(GameState& state, Delta delta, bool forward);
+};
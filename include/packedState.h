@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <span>
+#include <vector>
+
+#include <utils.h>
+#include <gameState.h>
+
+// Rectangle of cells that packed states index into. States are only comparable when they
+// share a layout, so pick one per level or search and keep it.
+struct PackedLayout {
+    Int2 origin = Int2::zero;
+    int width = 0;
+    int height = 0;
+
+    // Bounding box of the player, boxes and goals grown by margin cells on every side
+    static PackedLayout Around(const GameState& state, int margin = 1);
+
+    inline bool Contains(Int2 cell) const {
+        return cell.x >= origin.x && cell.y >= origin.y && cell.x < origin.x + width && cell.y < origin.y + height;
+    }
+    inline uint32_t Index(Int2 cell) const {
+        return static_cast<uint32_t>((cell.x - origin.x) + (cell.y - origin.y) * width);
+    }
+    inline Int2 Cell(uint32_t index) const {
+        return Int2(origin.x + static_cast<int>(index % width), origin.y + static_cast<int>(index / width));
+    }
+    inline size_t CellCount() const { return (size_t)width * height; }
+    inline size_t WordCount() const { return (CellCount() + 63) / 64; }
+
+    bool operator==(const PackedLayout& other) const = default;
+};
+
+// Occupancy words of one packed state, stored inline for layouts of up to 512 cells so
+// copying the state of a typical level does not allocate. Larger layouts go to the heap.
+class PackedWords {
+public:
+    static constexpr size_t INLINE_WORDS = 8;
+
+    PackedWords() = default;
+    PackedWords(size_t count, uint64_t value) { Assign(count, value); }
+
+    void Assign(size_t count, uint64_t value) {
+        size = count;
+        if (count <= INLINE_WORDS) {
+            heapWords.clear();
+            std::fill_n(inlineWords.begin(), count, value);
+        }
+        else heapWords.assign(count, value);
+    }
+    void Assign(const uint64_t* first, const uint64_t* last) {
+        size = static_cast<size_t>(last - first);
+        if (size <= INLINE_WORDS) {
+            heapWords.clear();
+            std::copy(first, last, inlineWords.begin());
+        }
+        else heapWords.assign(first, last);
+    }
+
+    inline size_t Size() const { return size; }
+    inline uint64_t* Data() { return size <= INLINE_WORDS ? inlineWords.data() : heapWords.data(); }
+    inline const uint64_t* Data() const { return size <= INLINE_WORDS ? inlineWords.data() : heapWords.data(); }
+    inline uint64_t& operator[](size_t i) { return Data()[i]; }
+    inline uint64_t operator[](size_t i) const { return Data()[i]; }
+    inline const uint64_t* begin() const { return Data(); }
+    inline const uint64_t* end() const { return Data() + size; }
+
+    bool operator==(const PackedWords& other) const {
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+
+private:
+    std::array<uint64_t, INLINE_WORDS> inlineWords{};
+    std::vector<uint64_t> heapWords;
+    size_t size = 0;
+};
+
+// Box occupancy as one bit per layout cell plus the player cell, with a Zobrist style hash
+// kept up to date on every change. Walls and goals are not stored, they belong to the level.
+// Copies of states over layouts too big for PackedWords allocate, so anything holding many
+// states should keep them in a PackedStateStore.
+class PackedState {
+public:
+    struct Hash {
+        size_t operator()(const PackedState& state) const { return static_cast<size_t>(state.GetHash()); }
+    };
+
+    PackedState() = default;
+    explicit PackedState(const PackedLayout& layout) : words(layout.WordCount(), 0) {}
+
+    // Returns false, leaving out untouched, if the player or a box lies outside the layout
+    static bool Capture(const GameState& state, const PackedLayout& layout, PackedState& out);
+    // Moves the state's existing boxes onto the packed cells, keeping each box that did not
+    // move where it is. Returns false if the box counts differ.
+    bool Restore(GameState& state, const PackedLayout& layout) const;
+
+    inline bool HasBox(uint32_t index) const { return (words[index >> 6] >> (index & 63)) & 1; }
+    void SetBox(uint32_t index);
+    void ResetBox(uint32_t index);
+    inline void MoveBox(uint32_t from, uint32_t to) { ResetBox(from); SetBox(to); }
+
+    inline uint32_t Player() const { return player; }
+    inline void SetPlayer(uint32_t index) { player = index; }
+
+    uint64_t GetHash() const;
+    size_t BoxCount() const;
+    std::span<const uint64_t> Words() const { return { words.Data(), words.Size() }; }
+
+    bool operator==(const PackedState& other) const {
+        return boxHash == other.boxHash && player == other.player && words == other.words;
+    }
+
+private:
+    friend class PackedStateStore;
+
+    PackedWords words;
+    uint32_t player = 0;
+    // Hash of the boxes alone, the player cell is mixed in by GetHash
+    uint64_t boxHash = 0;
+};
+
+// Many states of one layout stored back to back with no per state allocation, for undo
+// history, search frontiers and replays that need to hold millions of them
+class PackedStateStore {
+public:
+    explicit PackedStateStore(const PackedLayout& layout)
+        : layout(layout), wordCount(layout.WordCount()) {}
+
+    uint32_t Add(const PackedState& state);
+    PackedState Get(uint32_t id) const;
+    void Truncate(size_t count);
+    void Clear() { data.clear(); }
+
+    const PackedLayout& Layout() const { return layout; }
+    size_t Size() const { return data.size() / Stride(); }
+    size_t BytesUsed() const { return data.size() * sizeof(uint64_t); }
+
+private:
+    PackedLayout layout;
+    size_t wordCount;
+    // Each entry is the box hash, the player cell, then the occupancy words
+    std::vector<uint64_t> data;
+
+    inline size_t Stride() const { return wordCount + 2; }
+};
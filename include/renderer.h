@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <glad.h>
 #include <utils.h>
 #include <glm/glm.hpp>
@@ -44,11 +45,57 @@ struct Texture {
     GLenum pixelFormat = GL_RGBA8;
 };
 
+// GL buffer that grows geometrically when a write needs more room than it has
+struct GrowableBuffer {
+    unsigned int id = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+    GLenum usage = GL_DYNAMIC_DRAW;
+    size_t capacity = 0;
+    size_t peakCapacity = 0;
+
+    void Create(size_t initialCapacity, GLenum bufferTarget = GL_ARRAY_BUFFER, GLenum bufferUsage = GL_DYNAMIC_DRAW);
+    // Leaves the buffer bound to its target. Growing changes id, so rebind any
+    // attribute pointers that refer to it afterwards.
+    void Reserve(size_t bytes, bool preserveContents);
+    void Upload(size_t offset, const void* data, size_t bytes);
+    // Replaces the whole contents, orphaning the previous storage
+    void Stream(const void* data, size_t bytes);
+};
+
 extern glm::mat4 projection;
 
+struct FrameStats {
+    size_t bytesUploaded = 0;
+    uint32_t drawCalls = 0;
+    uint32_t quadsBatched = 0;
+    uint32_t chunksDrawn = 0;
+    uint32_t chunksCulled = 0;
+    uint32_t objectsDrawn = 0;
+    uint32_t objectsCulled = 0;
+};
+
+extern FrameStats frameStats;
+
 void InitRenderer();
+// Decoded image pixels waiting to be uploaded. Decoding touches no GL state, so it can run
+// on any thread, uploading has to happen on the GL thread.
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+};
+
+bool DecodeImage(const char* path, ImageData& image);
+Texture UploadTexture(const ImageData& image);
 Texture LoadTexture(const char* path);
 void ClearColor(Color color);
+void ResetFrameStats();
+Rect GetVisibleRect();
 void DrawRect(Vec2 position, Vec2 size, Color backgroundColor,
     float roundRadius = 0.0f, float borderWidth = 0.0f, Color borderColor = BLANK);
 void DrawTexturedRect(Vec2 position, Vec2 size, Texture texture, Vec2 baseUV = Vec2::zero, Vec2 uvOffset = Vec2::one, Color tint = WHITE);
+// Tints the red channel of a single-channel texture, used for glyphs from a font atlas
+void DrawGlyph(Vec2 position, Vec2 size, Texture atlas, Vec2 baseUV, Vec2 uvOffset, Color color);
+// Draws every rect queued so far. Call before issuing other GL draws so queued rects keep their order.
+void FlushRenderer();
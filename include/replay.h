@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <utils.h>
+#include <gameState.h>
+#include <levels.h>
+
+enum class ReplayEventType : uint8_t {
+    Move,
+    AddLevel,
+    Undo,
+    Redo,
+};
+
+struct ReplayEvent {
+    ReplayEventType type = ReplayEventType::Move;
+    // Simulation step the event ran on, real time playback feeds it back on the same step
+    uint32_t step = 0;
+    // Move: the requested direction and whether the recording session accepted it
+    Int2 direction = Int2::zero;
+    bool moved = false;
+    // AddLevel: index into Replay::levelPaths and where the level was stamped
+    uint32_t level = 0;
+    Int2 position = Int2::zero;
+};
+
+struct Replay {
+    std::string baseMap;
+    Int2 playerStart = Int2::zero;
+    std::vector<std::string> levelPaths;
+    std::vector<ReplayEvent> events;
+    // StateChecksum of the final state, 0 when the recording was never finished
+    uint64_t finalChecksum = 0;
+};
+
+// Order independent hash of the player and box cells, for checking playback ends where
+// the recording did
+uint64_t StateChecksum(const GameState& state);
+
+bool SaveReplay(const Replay& replay, const char* filename);
+bool LoadReplay(const char* filename, Replay& replay);
+
+class ReplayRecorder {
+public:
+    void Begin(const std::string& baseMap, Int2 playerStart);
+    // Refused moves are kept once per run of identical attempts, since a held key retries
+    // them every simulation step and a rule change may let them through
+    void RecordMove(uint32_t step, Int2 direction, bool moved);
+    void RecordAddLevel(uint32_t step, const std::string& path, Int2 position);
+    void RecordUndo(uint32_t step);
+    void RecordRedo(uint32_t step);
+    const Replay& Finish(const GameState& state);
+
+    const Replay& GetReplay() const { return replay; }
+
+private:
+    Replay replay;
+};
+
+struct PlaybackResult {
+    size_t eventsApplied = 0;
+    size_t movesApplied = 0;
+    size_t movesRefused = 0;
+    // Moves accepted during recording but refused now or the other way around. The first
+    // one is the event index where the rules diverged.
+    size_t divergences = 0;
+    size_t firstDivergence = SIZE_MAX;
+    uint64_t checksum = 0;
+    bool checksumMatches = true;
+};
+
+// Re-runs replays headless at full speed against a fresh GameState, with no animation or
+// rendering. Level files are loaded once and shared by every replay run through it.
+class ReplayRunner {
+public:
+    // Returns false if a level file fails to load
+    bool Run(const Replay& replay, PlaybackResult& result, GameState* finalState = nullptr);
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<Level>> baseMaps;
+    std::unordered_map<std::string, std::unique_ptr<Level>> levels;
+
+    const Level* GetLevel(std::unordered_map<std::string, std::unique_ptr<Level>>& cache,
+        const std::string& path, Int2 objectOffset);
+};
+
+// Hands recorded events back out as the simulation reaches the step they ran on
+class ReplayPlayer {
+public:
+    explicit ReplayPlayer(Replay replay) : replay(std::move(replay)) {}
+
+    bool Next(uint32_t step, ReplayEvent& event);
+    bool Finished() const { return nextEvent >= replay.events.size(); }
+    const Replay& GetReplay() const { return replay; }
+
+private:
+    Replay replay;
+    size_t nextEvent = 0;
+};
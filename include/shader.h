@@ -7,6 +7,12 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+
+// Resolved uniform location, look it up once with Shader::getUniform and keep it around
+struct UniformHandle {
+    int location = -1;
+};
 
 class Shader {
 public:
@@ -18,6 +24,7 @@ public:
     void use();
 
     int tryGetLoc(const std::string& name) const;
+    UniformHandle getUniform(const std::string& name) const;
 
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
@@ -26,4 +33,17 @@ public:
     void setVec3(const std::string &name, glm::vec3 value) const;
     void setVec4(const std::string &name, glm::vec4 value) const;
     void setMat4(const std::string& name, glm::mat4 value) const;
+
+    void setBool(UniformHandle uniform, bool value) const;
+    void setInt(UniformHandle uniform, int value) const;
+    void setFloat(UniformHandle uniform, float value) const;
+    void setVec2(UniformHandle uniform, glm::vec2 value) const;
+    void setVec3(UniformHandle uniform, glm::vec3 value) const;
+    void setVec4(UniformHandle uniform, glm::vec4 value) const;
+    void setMat4(UniformHandle uniform, glm::mat4 value) const;
+private:
+    // Filled from program introspection right after linking
+    std::unordered_map<std::string, int> uniformLocations;
+
+    void cacheUniformLocations();
 };
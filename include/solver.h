@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <utils.h>
+#include <gameState.h>
+
+enum class SolverAlgorithm {
+    AStar,
+    IDAStar,
+};
+
+enum class SolveStatus {
+    Solved,
+    // The whole reachable state space was searched without putting every box on a goal
+    Unsolvable,
+    // Gave up after SolverOptions::maxNodes states, or ran out of states on a board that
+    // searchMargin clipped, so a solution may lie outside the searched region
+    LimitReached,
+    // No goals, fewer goals than boxes, or the player starts inside a wall or box
+    InvalidBoard,
+};
+
+struct SolverOptions {
+    SolverAlgorithm algorithm = SolverAlgorithm::AStar;
+    size_t maxNodes = 2'000'000;
+    // The search covers every cell the player can walk to, but stops this many cells past the
+    // bounding box of the player, boxes and goals so open drafted worlds stay finite
+    int searchMargin = 16;
+};
+
+struct SolveResult {
+    SolveStatus status = SolveStatus::InvalidBoard;
+    // Player steps from the starting position, each one a valid GameState::Move
+    std::vector<Int2> moves;
+    uint32_t pushCount = 0;
+    size_t nodesExpanded = 0;
+    size_t nodesGenerated = 0;
+};
+
+struct ExploreOptions {
+    // 0 uses every hardware thread
+    int threadCount = 0;
+    size_t maxStates = 10'000'000;
+    // Caps the walkable region the same way as SolverOptions::searchMargin
+    int searchMargin = 16;
+    // Stop at the first state with every box on a goal instead of visiting the whole space
+    bool stopAtSolution = true;
+    // Skip pushes onto dead squares or into frozen blocks, which can never lead to a solution.
+    // Has no effect on boards without goals.
+    bool pruneDeadlocks = true;
+};
+
+struct ExploreResult {
+    // Solved if some reachable state has every box on a goal, Unsolvable once the whole space
+    // was visited without one, which is always the case on boards without goals
+    SolveStatus status = SolveStatus::InvalidBoard;
+    size_t statesVisited = 0;
+    size_t solvedStates = 0;
+    size_t steals = 0;
+    int threadCount = 0;
+};
+
+// Searches over pushes rather than single steps: a state is the sorted box cells plus the
+// top-left cell the player can walk to, hashed with Zobrist keys into a transposition table.
+// The heuristic sums each box's push distance to its nearest goal, so A* finds push-optimal
+// solutions. Squares no box can be pushed to a goal from and frozen 2x2 blocks are pruned.
+SolveResult Solve(const GameState& state, const SolverOptions& options = {});
+
+// Visits the reachable box configurations across threads, sharing a sharded visited set and
+// balancing the frontier with work stealing. Meant for validating large drafted worlds where
+// an exhaustive answer matters more than a solution path.
+ExploreResult ExploreReachable(const GameState& state, const ExploreOptions& options = {});
@@ -7,18 +7,23 @@
 #include <freetype/freetype.h>
 #include <freetype/ftglyph.h>
 #include <array>
+#include <string_view>
+#include <vector>
 
 constexpr int ASCII_BEGIN = 32;
 constexpr int ASCII_END = 127;
 
 struct Character {
-    unsigned int textureID;
+    Vec2 uvOrigin;
+    Vec2 uvSize;
     Int2 glyphSize;
     Int2 bearing;
     int advance;
 };
 
 struct Font {
+    // Every glyph packed into one single-channel texture
+    Texture atlas;
     std::array<Character, ASCII_END> characters;
     float lineHeight = 0.0f;
     int ascender = 0;
@@ -28,7 +33,39 @@ struct Font {
     float baseFontSize = 0.0f;
 };
 
+// Glyph metrics and the packed atlas pixels, before the atlas is uploaded
+struct FontBitmap {
+    Font font;
+    std::vector<unsigned char> atlasPixels;
+};
+
 void InitTextRenderer(Vec2 screenDPI);
+// Safe to call from any thread once InitTextRenderer has run
+bool RasterizeFont(const char* path, FontBitmap& bitmap);
+// GL thread only, creates the atlas texture for bitmap.font
+void UploadFontAtlas(FontBitmap& bitmap);
 Font* LoadFont(const char* path);
-void RenderText(const char* text, Font& font, float fontSize, Vec2 position, Color color = BLACK);
-Vec2 MeasureText(const char* text, Font& font, float fontSize);
\ No newline at end of file
+void RenderText(std::string_view text, Font& font, float fontSize, Vec2 position, Color color = BLACK);
+Vec2 MeasureText(std::string_view text, Font& font, float fontSize);
+
+// A word and the spaces after it, the unit text wraps by
+struct TextRun {
+    uint32_t start = 0;
+    uint32_t length = 0;
+    float width = 0.0f;
+    float spaceWidth = 0.0f;
+    // Followed by a newline, which is not part of the run
+    bool endsLine = false;
+};
+
+struct TextLine {
+    uint32_t start = 0;
+    uint32_t length = 0;
+    float width = 0.0f;
+};
+
+// Measures each word once so the text can be broken to any width without touching the glyphs
+// again. Returns the size unwrapped, the same as MeasureText.
+Vec2 MeasureRuns(std::string_view text, Font& font, float fontSize, std::vector<TextRun>& runs);
+// Greedy word wrap. Lines leave out the spaces they end on.
+void BreakLines(const std::vector<TextRun>& runs, float maxWidth, std::vector<TextLine>& lines);
\ No newline at end of file
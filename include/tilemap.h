@@ -3,12 +3,12 @@
 #include <stdint.h>
 #include <vector>
 #include <unordered_map>
-#include <unordered_set>
 #include <optional>
 
 #include <utils.h>
 #include <tiles.h>
 #include <gameObjects.h>
+#include <gameState.h>
 #include <levels.h>
 #include <stb_image/stb_image.h>
 #include <shader.h>
@@ -17,27 +17,50 @@
 class Tilemap {
 private:
     struct TilesetLookup {
-        const tmx::Tileset tileset;
+        TilesetInfo tileset;
         uint32_t firstGID;
         uint32_t lastGID;
         Texture texture;
     };
 
+    struct TileInstance {
+        Vec2 worldPos;
+        uint32_t tileIndex;
+    };
+
+    // Range of the shared instance buffer holding one chunk's tiles
+    struct ChunkMesh {
+        static constexpr uint32_t NO_SLOT = 0xFFFFFFFF;
+
+        uint32_t firstInstance = NO_SLOT;
+        uint32_t instanceCount = 0;
+        bool dirty = true;
+    };
+
     unsigned int tileVAO = 0;
     unsigned int quadVBO = 0;
     unsigned int quadEBO = 0;
-    unsigned int tileVBO = 0;
 
     Shader* shader;
+    UniformHandle uvStepUniform;
+    UniformHandle tilesetColsUniform;
+    UniformHandle projectionUniform;
+    UniformHandle tileSizeUniform;
 
     std::vector<ChunkLayer> layers;
     std::vector<TileInfo> tileLookup;
     std::vector<TilesetLookup> tilesetLookup;
-    std::unordered_set<Int2, Int2::Hash> collisionMap;
+
+    // One mesh per chunk, parallel to layers[i].chunks, rebuilt only when marked dirty
+    mutable std::vector<std::vector<ChunkMesh>> chunkMeshes;
+    mutable GrowableBuffer tileBuffer;
+    mutable std::vector<TileInstance> instanceScratch;
+    mutable uint32_t nextInstanceSlot = 0;
+
+    void UploadChunkMesh(const Chunk& chunk, ChunkMesh& mesh) const;
 public:
     Int2 tileSize;
-    std::unordered_map<Int2, ObjectData, Int2::Hash> objects;
-    GameObjects gameObjects;
+    GameState state;
 
     Tilemap() : tileSize(), shader() {}
 
@@ -45,9 +68,8 @@ public:
 
     std::optional<tmx::TileLayer::Tile> GetTile(int posX, int posY, int layer) const;
     std::optional<tmx::TileLayer::Tile> GetTile(Int2 pos, int layer) const;
-    std::optional<Chunk> GetChunk(Int2 pos, int layer) const;
+    const Chunk* GetChunk(Int2 pos, int layer) const;
     const TileInfo* GetTileInfo(uint32_t GID) const;
-    bool IsSolid(Int2 pos) const;
     bool CanPlaceLevel(const Level& level, Int2 position);
 
     Vec2 TilemapToWorldPos(Int2 tilemapPos, int layer = 0) const;
@@ -55,11 +77,10 @@ public:
 
     void DrawTile(TileInfo tile, Int2 pos, int layer, Vec2 offset = { 0, 0 }) const;
     void DrawTile(uint32_t GID, Int2 pos, int layer, Vec2 offset = { 0, 0 }) const;
-    void DrawObject(ObjectData object, int layer) const;
+    void DrawObject(const ObjectData& object, Int2 position, Vec2 offset, int layer) const;
     void Render(int layer) const;
+    void MarkChunkDirty(Int2 pos, int layer);
+    size_t GetPeakInstanceBufferSize() const { return tileBuffer.peakCapacity; }
 
-    template<typename ObjT>
-    void AddGameObject(ObjT gameObject, ObjectData objectData);
-    void AddGameObject(ObjectData objectData);
-    void AddLevel(const Level& level, Int2 position);
+    bool AddLevel(const Level& level, Int2 position);
 };
@@ -6,15 +6,11 @@
 #include <tmxlite/ObjectGroup.hpp>
 #include <tmxlite/Object.hpp>
 #include <utils.h>
-#include <glad.h>
-#include <GLFW/glfw3.h>
+#include <chunkIndex.h>
 
 struct TileInfo {
-    const tmx::Tileset::Tile* tile = nullptr;
     size_t tilesetIndex = 0;
     uint32_t GID = 0;
-
-    std::vector<tmx::Property> props;
 };
 
 struct Chunk {
@@ -26,4 +22,27 @@ struct Chunk {
 struct ChunkLayer {
     std::vector<Chunk> chunks;
     Vec2 offset;
+    // Tiled writes every chunk of a layer with the same size
+    Int2 chunkSize = Int2::zero;
+    ChunkIndex index;
+
+    ChunkLayer() = default;
+    ChunkLayer(Vec2 offset) : offset(offset) {}
+
+    inline Int2 ChunkCoord(Int2 tilePos) const {
+        return FloorDiv(tilePos, chunkSize);
+    }
+
+    inline const Chunk* FindChunk(Int2 tilePos) const {
+        if (chunks.empty()) return nullptr;
+        int32_t slot = index.Find(ChunkCoord(tilePos));
+        return slot == ChunkIndex::NONE ? nullptr : &chunks[slot];
+    }
+
+    // The chunk has to sit on the chunk grid, see Tilemap::CanPlaceLevel
+    inline void AddChunk(Chunk chunk) {
+        if (chunks.empty()) chunkSize = chunk.size;
+        index.Insert(ChunkCoord(chunk.position), static_cast<int32_t>(chunks.size()));
+        chunks.push_back(std::move(chunk));
+    }
 };
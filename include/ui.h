@@ -4,8 +4,11 @@
 #include <memory>
 #include <stdint.h>
 #include <utils.h>
-#include <functional>
 #include <string>
+#include <string_view>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
 #include <renderer.h>
 #include <algorithm>
 #include <text.h>
@@ -117,19 +120,101 @@ namespace UI {
     constexpr float rounded_3xl = 24.0f;
     constexpr float rounded_full = -1.0f;
 
+    // What an element's layout came out as last frame, keyed by its id. A subtree whose
+    // hash and final size match its entry is copied back instead of laid out again.
+    struct CachedLayout {
+        uint64_t subtreeHash = 0;
+        // Text elements keep their measured words and the lines they last wrapped to, so
+        // only a new label re-measures and only a new width re-breaks
+        uint64_t textHash = 0;
+        Vec2 measured = Vec2::zero;
+        std::vector<TextRun> runs;
+        std::vector<TextLine> lines;
+        float wrapWidth = -1.0f;
+        float fitHeight = 0;
+        Vec2 size = Vec2::zero;
+        // From the parent's position, or from the screen for absolutely positioned elements
+        Vec2 offset = Vec2::zero;
+        uint32_t lastFrame = 0;
+    };
+
+    struct Element;
+
+    // Callback state copied into the frame's arena. Elements are freed by clearing the arena
+    // without running destructors, so this is all an element keeps of a callback.
+    struct CallbackThunk {
+        void (*invoke)(void* state, Element& element) = nullptr;
+        void* state = nullptr;
+
+        explicit operator bool() const { return invoke != nullptr; }
+        void operator()(Element& element) const { invoke(state, element); }
+    };
+
+    // Holds a callable inline so passing one in never touches the heap. Captures have to be
+    // trivially copyable, since the copy in the arena is never destroyed.
+    class Callback {
+    public:
+        static constexpr size_t CAPACITY = 64;
+
+        Callback() = default;
+        Callback(std::nullptr_t) {}
+
+        template<typename F> requires (!std::is_same_v<std::decay_t<F>, Callback> && std::is_invocable_v<F&, Element&>)
+        Callback(F function) {
+            static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>,
+                "UI callbacks can only capture trivially copyable values, such as pointers and references");
+            static_assert(sizeof(F) <= CAPACITY && alignof(F) <= alignof(std::max_align_t), "UI callback captures too much");
+            new (storage) F(function);
+            invoke = [](void* state, Element& element) { (*static_cast<F*>(state))(element); };
+            size = sizeof(F);
+            align = alignof(F);
+        }
+
+        explicit operator bool() const { return invoke != nullptr; }
+
+        CallbackThunk CopyTo(Arena& arena) const {
+            if (invoke == nullptr) return {};
+            void* state = arena.allocBytes(size, align);
+            std::memcpy(state, storage, size);
+            return CallbackThunk{ invoke, state };
+        }
+
+    private:
+        alignas(std::max_align_t) std::byte storage[CAPACITY];
+        void (*invoke)(void* state, Element& element) = nullptr;
+        size_t size = 0;
+        size_t align = 1;
+    };
+
     struct Element {
         Element* parent = nullptr;
-        std::vector<Element*> children;
+        // Children as a list threaded through the arena, in the order they were opened
+        Element* firstChild = nullptr;
+        Element* lastChild = nullptr;
+        Element* nextSibling = nullptr;
+        uint32_t childCount = 0;
 
         Vec2 position = Vec2::zero;
         Vec2 size = Vec2::zero;
         Style style;
-        std::string label;
+        // Interned in the arena and null terminated
+        std::string_view label;
         uint64_t id = 0;
 
-        std::function<void(Element&)> onHover = nullptr;
-        std::function<void(Element&)> onActive = nullptr;
-        std::function<void(Element&)> onClick = nullptr;
+        // Hash of the layout inputs of this element and everything under it
+        uint64_t subtreeHash = 0;
+        CachedLayout* cache = nullptr;
+        float fitHeight = 0;
+        // False when this element or one under it has no cache entry of its own
+        bool cacheable = true;
+        bool widthReused = false;
+        bool reused = false;
+        // Drawn line by line from cache->lines
+        bool isWrapped = false;
+
+        CallbackThunk onHover;
+        CallbackThunk onActive;
+        CallbackThunk onClick;
 
         inline float width() const { return size.x; }
         inline float height() const { return size.y; }
@@ -146,13 +231,28 @@ namespace UI {
         inline bool isText() const {
             return style.font != nullptr;
         }
+
+        struct ChildIterator {
+            Element* element;
+            Element* operator*() const { return element; }
+            ChildIterator& operator++() { element = element->nextSibling; return *this; }
+            bool operator!=(const ChildIterator& other) const { return element != other.element; }
+        };
+
+        struct ChildRange {
+            Element* first;
+            ChildIterator begin() const { return { first }; }
+            ChildIterator end() const { return { nullptr }; }
+        };
+
+        inline ChildRange children() const { return { firstChild }; }
     };
 
     struct Callbacks {
         const char* label = nullptr;
-        std::function<void(Element&)> onHover = nullptr;
-        std::function<void(Element&)> onActive = nullptr;
-        std::function<void(Element&)> onClick = nullptr;
+        Callback onHover;
+        Callback onActive;
+        Callback onClick;
     };
 
     struct PanelStyle {
@@ -224,23 +324,37 @@ namespace UI {
         }
     };
 
+    // Mixes in the parent's id rather than its address so ids stay the same from frame to
+    // frame, the layout cache and hot/active tracking both rely on that
+    inline uint64_t MixElementID(uint64_t hash, const Element* parent) {
+        uint64_t parentID = parent != nullptr ? parent->id : 0;
+        return hash ^ (parentID + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+    }
+
     inline uint64_t GetElementID(const char* label, Element* parent) {
         uint64_t hash = 1469598103934665603ull;
         while (*label) {
             hash ^= (unsigned char)(*label++);
             hash *= 1099511628211ull;
         }
-        return hash ^ reinterpret_cast<uintptr_t>(parent);
+        return MixElementID(hash, parent);
+    }
+
+    // Elements without a label are named by where they sit under their parent
+    inline uint64_t GetElementID(size_t childIndex, Element* parent) {
+        uint64_t hash = 1469598103934665603ull ^ (childIndex + 1);
+        hash *= 1099511628211ull;
+        return MixElementID(hash, parent);
     }
 
-    inline void AddCallbacks(Element* element, Callbacks callbacks) {
+    inline void AddCallbacks(Arena& arena, Element* element, const Callbacks& callbacks) {
         if (element == nullptr) return;
         if (callbacks.label == nullptr) return;
 
         element->id = GetElementID(callbacks.label, element->parent);
-        element->onHover = callbacks.onHover;
-        element->onActive = callbacks.onActive;
-        element->onClick = callbacks.onClick;
+        element->onHover = callbacks.onHover.CopyTo(arena);
+        element->onActive = callbacks.onActive.CopyTo(arena);
+        element->onClick = callbacks.onClick.CopyTo(arena);
     }
 }
 
@@ -251,33 +365,66 @@ public:
     uint64_t hotID = 0;
     uint64_t activeID = 0;
 
+    // Elements built and elements whose layout was worked out again in the last EndUI,
+    // the rest were copied from the layout cache
+    uint32_t elementCount = 0;
+    uint32_t relayoutCount = 0;
+
     UIContext(size_t arenaSize = sizeof(UI::Element) * 256) : elementArena(arenaSize) {}
 
     void BeginUI(Vec2 currentScreenSize, UI::MouseState currentFrameMouseState, UI::FlexDir rootFlexDir = UI::FlexDir::ROW);
     void EndUI();
 
+    const ArenaStats& GetArenaStats() const { return elementArena.Stats(); }
+
     void Render(UI::Element* element);
     void Render();
 
     void Panel(const UI::PanelStyle& style);
-    void Panel(const UI::PanelStyle& style, const std::function<void()> children);
-    void Panel(const UI::PanelStyle& style, UI::Callbacks callbacks);
-    void Panel(const UI::PanelStyle& style, UI::Callbacks callbacks, const std::function<void()> children);
-    void Text(std::string text, const UI::TextStyle& style);
+    void Panel(const UI::PanelStyle& style, const UI::Callbacks& callbacks);
+    void Text(std::string_view text, const UI::TextStyle& style);
+
+    // Children are built by calling straight into the lambda, rather than going through a
+    // std::function that might allocate for its captures
+    template<typename Children> requires std::is_invocable_v<Children&>
+    void Panel(const UI::PanelStyle& style, Children&& children) {
+        OpenElement(style.toStyle());
+        children();
+        CloseElement();
+    }
+
+    template<typename Children> requires std::is_invocable_v<Children&>
+    void Panel(const UI::PanelStyle& style, const UI::Callbacks& callbacks, Children&& children) {
+        OpenElement(style.toStyle());
+        if (!elementStack.empty()) UI::AddCallbacks(elementArena, elementStack.back(), callbacks);
+        children();
+        CloseElement();
+    }
 private:
     Arena elementArena;
     UI::MouseState mouseState;
     bool isContextActive = false;
     std::vector<uint64_t> idStack;
     std::vector<UI::Element*> elementStack;
+    // Scratch for the grow passes, kept so it stops allocating once it has grown
+    std::vector<UI::Element*> growable;
+
+    std::unordered_map<uint64_t, UI::CachedLayout> layoutCache;
+    uint32_t frame = 0;
 
     void OpenElement(const UI::Style& style = {});
+    std::string_view InternLabel(std::string_view text);
     void CloseElement();
 
     void FitHeights(UI::Element* element);
-    void WrapText();
+    void WrapText(UI::Element* element);
+    bool WrapLines(UI::Element* element);
     void GrowWidths();
     void GrowHeights();
     void LayoutElements();
     void ResolveCallbacks();
+
+    void RestoreWidths(UI::Element* element);
+    void RestoreLayout(UI::Element* element);
+    void StoreLayout();
 };
@@ -6,6 +6,7 @@
 #include <utility>
 #include <cassert>
 #include <limits>
+#include <stdint.h>
 
 #include <tmxlite/Types.hpp>
 #include <glm/glm.hpp>
@@ -43,7 +44,7 @@ struct Int2 {
     }
 
     Int2 operator-(const Int2& other) const {
-        return Int2(x - other.x, y + other.y);
+        return Int2(x - other.x, y - other.y);
     }
 
     Int2 operator*(const Int2& other) const {
@@ -308,6 +309,11 @@ struct Rect {
     Rect(Vec2 pos, Vec2 size) : x(pos.x), y(pos.y), width(size.x), height(size.y) {}
 };
 
+inline bool RectsOverlap(const Rect& a, const Rect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width
+        && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
 inline bool PointInRect(Vec2 point, Vec2 rectPos, Vec2 rectSize, float radius) {
     Vec2 halfSize = 0.5f * rectSize;
     Vec2 center = rectPos + halfSize;
@@ -316,44 +322,104 @@ inline bool PointInRect(Vec2 point, Vec2 rectPos, Vec2 rectSize, float radius) {
     return d < 0.0f;
 }
 
+inline int FloorDiv(int a, int b) {
+    int q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+inline Int2 FloorDiv(Int2 a, Int2 b) {
+    return Int2(FloorDiv(a.x, b.x), FloorDiv(a.y, b.y));
+}
+
+// SplitMix64 step: a well spread 64 bit hash of value, used for Zobrist keys and checksums
+inline uint64_t Mix64(uint64_t value) {
+    uint64_t z = value + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
 static inline float Smoothstep(float value) {
     return 3.0f * value * value - 2.0f * value * value * value;
 }
 
-struct Arena {
-    std::byte* buffer = nullptr;
+struct ArenaStats {
+    // Handed out since the last clear, alignment padding included
+    size_t bytesUsed = 0;
+    // Most bytesUsed has ever reached
+    size_t peakBytes = 0;
     size_t capacity = 0;
-    size_t offset = 0;
+    size_t blockCount = 0;
+};
 
-    Arena(size_t newCapacity) {
-        buffer = static_cast<std::byte*>(::operator new(newCapacity));
-        capacity = newCapacity;
-        offset = 0;
-    }
+// Bump allocator over a linked list of blocks. Running out of room chains on a new block
+// twice the size of the last instead of failing, and clear() folds everything back into a
+// single block big enough for the high-water mark, so a workload that repeats each frame
+// stops calling operator new after its first few frames. Destructors are never run.
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
 
-    ~Arena() { if (buffer) ::operator delete(buffer); }
+    void clear() noexcept;
 
-    void clear() noexcept { offset = 0; }
+    // Raw storage, align has to be a power of two
+    void* allocBytes(size_t size, size_t align) {
+        uintptr_t aligned = (cursor + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+        if (current == nullptr || aligned + size > limit) return allocSlow(size, align);
+
+        stats.bytesUsed += aligned + size - cursor;
+        if (stats.bytesUsed > stats.peakBytes) stats.peakBytes = stats.bytesUsed;
+        cursor = aligned + size;
+        return reinterpret_cast<void*>(aligned);
+    }
 
     template<typename T, typename... Args>
     T* alloc(Args&&... args) {
-        size_t align = alignof(T);
-        size_t alignedOffset = (offset + (align - 1)) & ~(align - 1);
+        void* ptr = allocBytes(sizeof(T), alignof(T));
+        return new (ptr) T(std::forward<Args>(args)...);
+    }
 
-        if (alignedOffset + sizeof(T) > capacity) {
-            return nullptr;
-        }
+    const ArenaStats& Stats() const { return stats; }
 
-        void* ptr = static_cast<void*>(buffer + alignedOffset);
+private:
+    struct Block {
+        Block* next;
+        size_t capacity;
+        std::byte* data() { return reinterpret_cast<std::byte*>(this + 1); }
+    };
 
-        T* obj = nullptr;
-        try {
-            obj = new (ptr) T(std::forward<Args>(args)...);
-        } catch (...) {
-            throw;
-        }
+    // Newest block first, allocation only ever bumps through the head
+    Block* current = nullptr;
+    uintptr_t cursor = 0;
+    uintptr_t limit = 0;
+    size_t nextBlockSize;
+    ArenaStats stats;
 
-        offset = alignedOffset + sizeof(T);
-        return obj;
+    void* allocSlow(size_t size, size_t align);
+    void PushBlock(size_t capacity);
+};
+
+// Lets std containers draw from an Arena. Memory comes back when the arena is cleared,
+// so deallocate does nothing and the container must not outlive the clear.
+template<typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    Arena* arena;
+
+    ArenaAllocator(Arena& arena) noexcept : arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arena->allocBytes(count * sizeof(T), alignof(T)));
     }
+    void deallocate(T*, size_t) noexcept {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena == other.arena; }
 };
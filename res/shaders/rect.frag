@@ -2,16 +2,15 @@
 
 in vec2 FragPos;
 in vec2 TexCoords;
+flat in vec4 rect;
+flat in float radius;
+flat in float border;
+flat in vec4 bgColor;
+flat in vec4 borderColor;
+flat in int mode; // 0 = rounded rect, 1 = textured, 2 = glyph
 
 out vec4 FragColor;
 
-uniform vec4 rect;
-uniform float radius;
-uniform float border;
-uniform vec4 bgColor;
-uniform vec4 borderColor;
-
-uniform bool useTexture;
 uniform sampler2D texture0;
 
 float sdRec(vec2 p, vec4 rec, float rad) {
@@ -28,5 +27,9 @@ void main() {
             ? bgColor 
             : borderColor
         : vec4(0.0);
-    FragColor = useTexture ? texture(texture0, TexCoords) * bgColor : col;
+    if (mode == 2) {
+        FragColor = vec4(bgColor.rgb, bgColor.a * texture(texture0, TexCoords).r);
+    } else {
+        FragColor = mode == 1 ? texture(texture0, TexCoords) * bgColor : col;
+    }
 }
\ No newline at end of file
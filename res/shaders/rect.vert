@@ -1,16 +1,32 @@
 #version 330 core
 layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec4 iRect;
+layout (location = 2) in vec4 iUVRec;
+layout (location = 3) in vec4 iColor;
+layout (location = 4) in vec4 iBorderColor;
+layout (location = 5) in vec3 iParams; // radius, border width, mode
 
 out vec2 FragPos;
 out vec2 TexCoords;
+flat out vec4 rect;
+flat out float radius;
+flat out float border;
+flat out vec4 bgColor;
+flat out vec4 borderColor;
+flat out int mode;
 
 uniform mat4 projection;
-uniform vec4 rect;
-uniform vec4 uvRec;
 
 void main() {
-    vec2 pos = aPos * rect.zw + rect.xy;
+    vec2 pos = aPos * iRect.zw + iRect.xy;
     gl_Position = projection * vec4(pos, 0.0, 1.0);
     FragPos = pos;
-    TexCoords = uvRec.xy + aPos * uvRec.zw;
-}
\ No newline at end of file
+    TexCoords = iUVRec.xy + aPos * iUVRec.zw;
+
+    rect = iRect;
+    radius = iParams.x;
+    border = iParams.y;
+    mode = int(iParams.z);
+    bgColor = iColor;
+    borderColor = iBorderColor;
+}
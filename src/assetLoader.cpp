@@ -0,0 +1,126 @@
+#include <assetLoader.h>
+
+#include <string>
+
+AssetLoader::AssetLoader(unsigned threadCount) {
+    if (threadCount == 0) {
+        unsigned cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back(&AssetLoader::WorkerLoop, this);
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobReady.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void AssetLoader::Submit(Job job) {
+    pending.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobReady.notify_one();
+}
+
+void AssetLoader::QueueUpload(Job upload) {
+    {
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        uploads.push_back(std::move(upload));
+    }
+    uploadReady.notify_all();
+}
+
+void AssetLoader::WorkerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+AssetHandle<Level> AssetLoader::LoadLevel(const char* path, Int2 objectOffset) {
+    AssetHandle<Level> handle;
+    handle.slot = std::make_shared<AssetHandle<Level>::Slot>();
+
+    // Levels need no GL, they are ready as soon as the worker has parsed them
+    Submit([this, slot = handle.slot, path = std::string(path), objectOffset] {
+        Level* level = ::LoadLevel(path.c_str(), objectOffset);
+        if (level != nullptr) {
+            slot->value = std::move(*level);
+            delete level;
+        }
+        Finish<Level>(*slot, level != nullptr);
+    });
+    return handle;
+}
+
+AssetHandle<Texture> AssetLoader::LoadTexture(const char* path) {
+    AssetHandle<Texture> handle;
+    handle.slot = std::make_shared<AssetHandle<Texture>::Slot>();
+
+    Submit([this, slot = handle.slot, path = std::string(path)] {
+        auto image = std::make_shared<ImageData>();
+        if (!DecodeImage(path.c_str(), *image)) {
+            Finish<Texture>(*slot, false);
+            return;
+        }
+        QueueUpload([this, slot, image] {
+            slot->value = UploadTexture(*image);
+            Finish<Texture>(*slot, true);
+        });
+    });
+    return handle;
+}
+
+AssetHandle<Font> AssetLoader::LoadFont(const char* path) {
+    AssetHandle<Font> handle;
+    handle.slot = std::make_shared<AssetHandle<Font>::Slot>();
+
+    Submit([this, slot = handle.slot, path = std::string(path)] {
+        auto bitmap = std::make_shared<FontBitmap>();
+        if (!RasterizeFont(path.c_str(), *bitmap)) {
+            Finish<Font>(*slot, false);
+            return;
+        }
+        QueueUpload([this, slot, bitmap] {
+            UploadFontAtlas(*bitmap);
+            slot->value = bitmap->font;
+            Finish<Font>(*slot, true);
+        });
+    });
+    return handle;
+}
+
+void AssetLoader::Update() {
+    {
+        std::lock_guard<std::mutex> lock(uploadMutex);
+        if (uploads.empty()) return;
+        std::swap(uploads, uploadScratch);
+    }
+    for (Job& upload : uploadScratch) upload();
+    uploadScratch.clear();
+}
+
+void AssetLoader::WaitAll() {
+    while (Pending() > 0) {
+        {
+            std::unique_lock<std::mutex> lock(uploadMutex);
+            uploadReady.wait(lock, [this] { return !uploads.empty() || Pending() == 0; });
+        }
+        Update();
+    }
+}
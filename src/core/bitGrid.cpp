@@ -0,0 +1,76 @@
+#include <bitGrid.h>
+#include <bit>
+
+BitGrid::Chunk& BitGrid::GetOrAddChunk(Int2 chunkCoord) {
+    int32_t slot = index.Find(chunkCoord);
+    if (slot != ChunkIndex::NONE) return chunks[slot];
+
+    index.Insert(chunkCoord, static_cast<int32_t>(chunks.size()));
+    chunks.push_back(Chunk{ chunkCoord });
+    return chunks.back();
+}
+
+const BitGrid::Chunk* BitGrid::GetChunk(Int2 chunkCoord) const {
+    int32_t slot = index.Find(chunkCoord);
+    if (slot == ChunkIndex::NONE) return nullptr;
+    return &chunks[slot];
+}
+
+void BitGrid::Set(Int2 cell) {
+    Chunk& chunk = GetOrAddChunk(ChunkCoord(cell));
+    chunk.rows[cell.y & BITGRID_CHUNK_MASK] |= static_cast<Row>(1u << (cell.x & BITGRID_CHUNK_MASK));
+}
+
+void BitGrid::Reset(Int2 cell) {
+    int32_t slot = index.Find(ChunkCoord(cell));
+    if (slot == ChunkIndex::NONE) return;
+    chunks[slot].rows[cell.y & BITGRID_CHUNK_MASK] &= static_cast<Row>(~(1u << (cell.x & BITGRID_CHUNK_MASK)));
+}
+
+void BitGrid::Stamp(const BitGrid& other, Int2 offset) {
+    int shiftX = offset.x & BITGRID_CHUNK_MASK;
+    bool aligned = shiftX == 0 && (offset.y & BITGRID_CHUNK_MASK) == 0;
+
+    for (const Chunk& src : other.chunks) {
+        Int2 base = Int2(src.coord.x * BITGRID_CHUNK_SIZE + offset.x, src.coord.y * BITGRID_CHUNK_SIZE + offset.y);
+
+        if (aligned) {
+            Chunk& dst = GetOrAddChunk(ChunkCoord(base));
+            for (int y = 0; y < BITGRID_CHUNK_SIZE; ++y) dst.rows[y] |= src.rows[y];
+            continue;
+        }
+
+        // Unaligned stamps straddle up to four destination chunks, split each row word in two
+        for (int y = 0; y < BITGRID_CHUNK_SIZE; ++y) {
+            uint32_t row = src.rows[y];
+            if (row == 0) continue;
+
+            Int2 cell = Int2(base.x, base.y + y);
+            Int2 chunkCoord = ChunkCoord(cell);
+            uint32_t shifted = row << shiftX;
+
+            GetOrAddChunk(chunkCoord).rows[cell.y & BITGRID_CHUNK_MASK] |= static_cast<Row>(shifted);
+            if (shifted >> BITGRID_CHUNK_SIZE) {
+                GetOrAddChunk(chunkCoord + Int2::right).rows[cell.y & BITGRID_CHUNK_MASK] |= static_cast<Row>(shifted >> BITGRID_CHUNK_SIZE);
+            }
+        }
+    }
+}
+
+void BitGrid::AddChunk(const Chunk& chunk) {
+    Chunk& dst = GetOrAddChunk(chunk.coord);
+    for (int y = 0; y < BITGRID_CHUNK_SIZE; ++y) dst.rows[y] |= chunk.rows[y];
+}
+
+void BitGrid::Clear() {
+    chunks.clear();
+    index.Clear();
+}
+
+size_t BitGrid::Count() const {
+    size_t count = 0;
+    for (const Chunk& chunk : chunks) {
+        for (Row row : chunk.rows) count += std::popcount(row);
+    }
+    return count;
+}
@@ -0,0 +1,103 @@
+#include <gameObjects.h>
+#include <utils.h>
+
+ObjectType stringToObjectType(const std::string& str) {
+    static const std::unordered_map<std::string, ObjectType> typeMap = {
+        {"Box", ObjectType::Box},
+        {"Goal", ObjectType::Goal},
+    };
+
+    auto it = typeMap.find(str);
+    if (it != typeMap.end()) {
+        return it->second;
+    }
+    return ObjectType::Unknown;
+}
+
+uint32_t& Pushables::GetOrAddCell(Int2 cell) {
+    Int2 chunkCoord = BitGrid::ChunkCoord(cell);
+    int32_t slot = index.Find(chunkCoord);
+    if (slot == ChunkIndex::NONE) {
+        slot = static_cast<int32_t>(chunks.size());
+        index.Insert(chunkCoord, slot);
+        chunks.emplace_back().fill(NONE);
+    }
+    return chunks[slot][CellSlot(cell)];
+}
+
+uint32_t Pushables::Add(const ObjectData& object) {
+    uint32_t& cell = GetOrAddCell(object.position);
+    if (cell != NONE) {
+        drawData[cell] = object;
+        StopMoving(cell);
+        return cell;
+    }
+
+    cell = static_cast<uint32_t>(position.size());
+    position.push_back(object.position);
+    offset.push_back(Vec2::zero);
+    moveDelta.push_back(Int2::zero);
+    move_t.push_back(0.0f);
+    isMoving.push_back(0);
+    drawData.push_back(object);
+    return cell;
+}
+
+void Pushables::Move(uint32_t id, Int2 to) {
+    assert(!Has(to));
+    GetOrAddCell(position[id]) = NONE;
+    GetOrAddCell(to) = id;
+    position[id] = to;
+}
+
+void Pushables::StopMoving(uint32_t id) {
+    offset[id] = Vec2::zero;
+    moveDelta[id] = Int2::zero;
+    move_t[id] = 0.0f;
+    isMoving[id] = 0;
+}
+
+void Pushables::StartPushChain() {
+    for (uint32_t id : pushChain) StopMoving(id);
+    pushChain.clear();
+}
+
+void Pushables::Clear() {
+    position.clear();
+    offset.clear();
+    moveDelta.clear();
+    move_t.clear();
+    isMoving.clear();
+    pushChain.clear();
+    drawData.clear();
+    chunks.clear();
+    index.Clear();
+}
+
+void Push(Pushables& pushables, uint32_t id, Int2 direction) {
+    pushables.moveDelta[id] = direction;
+    pushables.move_t[id] = 0.0f;
+    pushables.isMoving[id] = 1;
+    pushables.pushChain.push_back(id);
+}
+
+static inline Vec2 PushOffset(const Pushables& pushables, size_t id, float t) {
+    return -Vec2(pushables.moveDelta[id]) * (1.0f - Smoothstep(t)) * (Vec2)pushables.drawData[id].size;
+}
+
+void AnimatePushables(Pushables& pushables, float t) {
+    for (uint32_t id : pushables.pushChain) {
+        if (pushables.isMoving[id]) pushables.offset[id] = PushOffset(pushables, id, t);
+    }
+}
+
+void UpdatePushables(Pushables& pushables, float tick_t) {
+    for (uint32_t id : pushables.pushChain) {
+        if (!pushables.isMoving[id]) continue;
+
+        pushables.move_t[id] = tick_t;
+        pushables.offset[id] = PushOffset(pushables, id, tick_t);
+        if (tick_t >= 1.0f) pushables.StopMoving(id);
+    }
+    if (tick_t >= 1.0f) pushables.pushChain.clear();
+}
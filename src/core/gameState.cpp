@@ -0,0 +1,234 @@
+#include <gameState.h>
+
+#include <array>
+#include <vector>
+
+namespace {
+
+// Freeze test from a single push: a box is stuck along an axis when a wall sits on either
+// side, dead squares sit on both sides, or a neighbouring box along it is itself stuck with
+// this box counted as a wall. A box stuck along both axes can never move again.
+class FreezeCheck {
+public:
+    FreezeCheck(const GameState& state, Int2 movedFrom, Int2 movedTo)
+        : state(state), movedFrom(movedFrom), movedTo(movedTo) {}
+
+    bool IsDeadlocked() {
+        return IsFrozen(movedTo) && offGoal;
+    }
+
+private:
+    // Chains longer than this are treated as able to move, which errs towards allowing the push
+    static constexpr int MAX_DEPTH = 16;
+
+    const GameState& state;
+    Int2 movedFrom;
+    Int2 movedTo;
+    std::array<Int2, MAX_DEPTH> assumedWalls;
+    int depth = 0;
+    bool offGoal = false;
+
+    bool HasBox(Int2 pos) const {
+        if (pos == movedTo) return true;
+        if (pos == movedFrom) return false;
+        return state.HasBox(pos);
+    }
+
+    bool IsWall(Int2 pos) const {
+        if (state.IsSolid(pos)) return true;
+        for (int i = 0; i < depth; ++i) {
+            if (assumedWalls[i] == pos) return true;
+        }
+        return false;
+    }
+
+    bool IsStuckAlong(Int2 pos, Int2 axis) {
+        Int2 a = pos - axis;
+        Int2 b = pos + axis;
+        if (IsWall(a) || IsWall(b)) return true;
+        if (state.IsDeadSquare(a) && state.IsDeadSquare(b)) return true;
+        if (depth == MAX_DEPTH) return false;
+
+        assumedWalls[depth++] = pos;
+        bool stuck = (HasBox(a) && IsFrozen(a)) || (HasBox(b) && IsFrozen(b));
+        depth--;
+        return stuck;
+    }
+
+    bool IsFrozen(Int2 pos) {
+        bool frozen = IsStuckAlong(pos, Int2::right) && IsStuckAlong(pos, Int2::up);
+        if (frozen && !state.IsGoal(pos)) offGoal = true;
+        return frozen;
+    }
+};
+
+}
+
+MoveResult GameState::Move(Int2 direction) {
+    Int2 targetPos = playerPos + direction;
+    if (IsSolid(targetPos)) return {};
+
+    uint32_t pushCount = 0;
+    Int2 currPos = targetPos;
+    while (HasBox(currPos)) {
+        pushCount++;
+        currPos += direction;
+    }
+    if (pushCount > 0 && IsSolid(currPos)) return {};
+    if (pushCount > 0 && blockDeadlockPushes && !goals.Empty() && IsDeadlockPush(targetPos, currPos)) {
+        MoveResult refused;
+        refused.direction = direction;
+        refused.deadlock = true;
+        return refused;
+    }
+
+    // Shift the far end of the chain first so every box moves into an empty cell
+    gameObjects.boxes.StartPushChain();
+    for (uint32_t i = pushCount; i > 0; --i) {
+        Int2 boxPos = playerPos + direction * static_cast<int>(i);
+        uint32_t id = gameObjects.boxes.Find(boxPos);
+        gameObjects.boxes.Move(id, boxPos + direction);
+        Push(gameObjects.boxes, id, direction);
+    }
+
+    playerPos = targetPos;
+    return MoveResult{ true, direction, targetPos, pushCount };
+}
+
+bool GameState::IsDeadlockPush(Int2 from, Int2 to) const {
+    if (IsDeadSquare(to)) return true;
+    return FreezeCheck(*this, from, to).IsDeadlocked();
+}
+
+void GameState::MoveBox(Int2 from, Int2 to) {
+    uint32_t id = gameObjects.boxes.Find(from);
+    if (id == Pushables::NONE) return;
+    gameObjects.boxes.Move(id, to);
+    gameObjects.boxes.StopMoving(id);
+}
+
+bool GameState::IsSolved() const {
+    if (goals.Empty()) return false;
+    for (Int2 box : gameObjects.boxes.position) {
+        if (!IsGoal(box)) return false;
+    }
+    return true;
+}
+
+void GameState::AddGameObject(ObjectData objectData) {
+    switch (objectData.type) {
+    case ObjectType::Box:
+        gameObjects.boxes.Add(objectData);
+        break;
+    case ObjectType::Goal:
+        goals.Set(objectData.position);
+        break;
+    default: break;
+    }
+}
+
+void GameState::AddLevel(const Level& level, Int2 position) {
+    collisionMap.Stamp(level.collisionMap, position);
+
+    Int2 regionMin = Int2::max;
+    Int2 regionMax = Int2::min;
+    auto extend = [&](Int2 cell) {
+        regionMin = Int2(std::min(regionMin.x, cell.x), std::min(regionMin.y, cell.y));
+        regionMax = Int2(std::max(regionMax.x, cell.x + 1), std::max(regionMax.y, cell.y + 1));
+    };
+    for (const BitGrid::Chunk& chunk : level.collisionMap.Chunks()) {
+        Int2 origin = chunk.coord * BITGRID_CHUNK_SIZE + position;
+        extend(origin);
+        extend(origin + Int2(BITGRID_CHUNK_SIZE - 1, BITGRID_CHUNK_SIZE - 1));
+    }
+
+    for (const ObjectData& object : level.objects) {
+        ObjectData newObject = object;
+        newObject.position += position;
+        AddGameObject(newObject);
+        if (newObject.type == ObjectType::Goal) extend(newObject.position);
+    }
+
+    // Walls next to the room can change which cells just outside it are dead
+    if (regionMin.x <= regionMax.x) {
+        Int2 margin(BITGRID_CHUNK_SIZE, BITGRID_CHUNK_SIZE);
+        UpdateDeadSquares(regionMin - margin, regionMax + margin);
+    }
+}
+
+void GameState::UpdateDeadSquares(Int2 regionMin, Int2 regionMax) {
+    int width = regionMax.x - regionMin.x;
+    int height = regionMax.y - regionMin.y;
+    auto inRegion = [&](Int2 cell) {
+        return cell.x >= regionMin.x && cell.y >= regionMin.y && cell.x < regionMax.x && cell.y < regionMax.y;
+    };
+    auto localIndex = [&](Int2 cell) {
+        return (size_t)(cell.x - regionMin.x) + (size_t)(cell.y - regionMin.y) * width;
+    };
+    // Only cells inside a stamped room can be dead, everything else is open floor
+    auto isKnown = [&](Int2 cell) {
+        return collisionMap.GetChunk(BitGrid::ChunkCoord(cell)) != nullptr;
+    };
+    const Int2 directions[4] = { Int2::up, Int2::down, Int2::left, Int2::right };
+
+    // Live cells are those a box can be pulled back to from a goal or from live floor
+    // outside the region: pulling from t to p = t - d needs p and p - d to be open
+    std::vector<uint8_t> live((size_t)width * height, 0);
+    std::vector<Int2> queue;
+    for (int y = regionMin.y; y < regionMax.y; ++y) {
+        for (int x = regionMin.x; x < regionMax.x; ++x) {
+            Int2 cell(x, y);
+            deadSquares.Reset(cell);
+            if (IsSolid(cell)) continue;
+
+            bool seed = IsGoal(cell) || !isKnown(cell);
+            for (int d = 0; d < 4 && !seed; ++d) {
+                Int2 target = cell + directions[d];
+                if (inRegion(target) || IsSolid(target) || IsDeadSquare(target)) continue;
+                seed = !IsSolid(cell - directions[d]);
+            }
+            if (seed) {
+                live[localIndex(cell)] = 1;
+                queue.push_back(cell);
+            }
+        }
+    }
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        Int2 target = queue[head];
+        for (Int2 dir : directions) {
+            Int2 from = target - dir;
+            if (!inRegion(from) || live[localIndex(from)]) continue;
+            if (IsSolid(from) || IsSolid(from - dir)) continue;
+            live[localIndex(from)] = 1;
+            queue.push_back(from);
+        }
+    }
+
+    for (int y = regionMin.y; y < regionMax.y; ++y) {
+        for (int x = regionMin.x; x < regionMax.x; ++x) {
+            Int2 cell(x, y);
+            if (!live[localIndex(cell)] && !IsSolid(cell)) deadSquares.Set(cell);
+        }
+    }
+
+    // A goal in the new room can revive dead cells outside the region that reach it
+    std::vector<Int2> revive;
+    for (Int2 cell : queue) {
+        for (Int2 dir : directions) {
+            Int2 from = cell - dir;
+            if (inRegion(from) || !IsDeadSquare(from) || IsSolid(from - dir)) continue;
+            deadSquares.Reset(from);
+            revive.push_back(from);
+        }
+    }
+    for (size_t head = 0; head < revive.size(); ++head) {
+        Int2 target = revive[head];
+        for (Int2 dir : directions) {
+            Int2 from = target - dir;
+            if (!IsDeadSquare(from) || IsSolid(from - dir)) continue;
+            deadSquares.Reset(from);
+            revive.push_back(from);
+        }
+    }
+}
@@ -0,0 +1,313 @@
+#include <levelCache.h>
+#include <mappedFile.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Every record is a multiple of 4 bytes and the header of 8, so the whole file stays
+// aligned for reading records straight out of the mapping
+constexpr char LEVEL_CACHE_MAGIC[4] = { 'S', 'K', 'L', 'V' };
+constexpr uint32_t LEVEL_CACHE_VERSION = 1;
+// Chunk indices are dense over the bounding box of their chunks, so a corrupt coordinate
+// would size one to the whole int range. Levels stay well within this many chunks of the origin.
+constexpr int32_t MAX_CHUNK_COORD = 1 << 10;
+
+namespace {
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    int32_t sizeX, sizeY;
+    int32_t tileWidth, tileHeight;
+    uint32_t exits;
+    uint32_t layerCount;
+    uint32_t collisionChunkCount;
+    uint32_t objectCount;
+    uint32_t tilesetCount;
+    uint32_t reserved;
+};
+
+// Followed by chunkCount chunks, each a ChunkRecord and width * height TileRecords
+struct LayerRecord {
+    float offsetX, offsetY;
+    uint32_t chunkCount;
+    uint32_t reserved;
+};
+
+struct ChunkRecord {
+    int32_t x, y;
+    int32_t width, height;
+};
+
+struct TileRecord {
+    uint32_t ID;
+    uint32_t flipFlags;
+};
+
+struct CollisionRecord {
+    int32_t x, y;
+    BitGrid::Row rows[BITGRID_CHUNK_SIZE];
+};
+
+struct ObjectRecord {
+    int32_t x, y;
+    int32_t width, height;
+    uint32_t type;
+    uint32_t tileGID;
+    float rotation;
+    uint32_t visible;
+};
+
+// Followed by the image path padded to 4 bytes, then the tile mask words
+struct TilesetRecord {
+    uint32_t firstGID;
+    uint32_t lastGID;
+    uint32_t tileCount;
+    uint32_t columns;
+    int32_t imageWidth, imageHeight;
+    uint32_t pathLength;
+};
+
+static_assert(sizeof(CacheHeader) % 8 == 0 && sizeof(CollisionRecord) % 4 == 0);
+
+// Bounds checked cursor over the mapped bytes
+class CacheReader {
+public:
+    CacheReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    template<typename T>
+    bool Read(T& out) {
+        if (size - offset < sizeof(T)) return false;
+        std::memcpy(&out, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    // Returns nullptr if fewer than count records are left
+    template<typename T>
+    const uint8_t* Take(size_t count) {
+        if (count > (size - offset) / sizeof(T)) return nullptr;
+        const uint8_t* start = data + offset;
+        offset += count * sizeof(T);
+        return start;
+    }
+
+    // Whether count records of at least recordSize bytes could still follow, checked before
+    // reserving so a corrupt count fails the read instead of the allocation
+    bool CanHold(size_t count, size_t recordSize) const { return count <= (size - offset) / recordSize; }
+
+    bool AtEnd() const { return offset == size; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+struct SourceStamp {
+    bool exists = false;
+    uint64_t size = 0;
+    int64_t time = 0;
+};
+
+static SourceStamp GetSourceStamp(const char* filename) {
+    std::error_code error;
+    SourceStamp stamp;
+    stamp.size = std::filesystem::file_size(filename, error);
+    if (error) return stamp;
+    auto time = std::filesystem::last_write_time(filename, error);
+    if (error) return stamp;
+    stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+    stamp.exists = true;
+    return stamp;
+}
+
+template<typename T>
+static void Write(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static size_t PaddedLength(size_t length) { return (length + 3) & ~size_t(3); }
+
+static bool InChunkRange(Int2 chunkCoord) {
+    return chunkCoord.x >= -MAX_CHUNK_COORD && chunkCoord.x <= MAX_CHUNK_COORD
+        && chunkCoord.y >= -MAX_CHUNK_COORD && chunkCoord.y <= MAX_CHUNK_COORD;
+}
+
+}
+
+std::string LevelCachePath(const char* tmxFile) {
+    return std::filesystem::path(tmxFile).replace_extension(".lvl").string();
+}
+
+bool WriteLevelCache(const Level& level, const char* tmxFile, const char* cacheFile) {
+    SourceStamp stamp = GetSourceStamp(tmxFile);
+    if (!stamp.exists) return false;
+
+    std::ofstream file(cacheFile, std::ios::binary);
+    if (!file) return false;
+
+    CacheHeader header{};
+    std::memcpy(header.magic, LEVEL_CACHE_MAGIC, sizeof(header.magic));
+    header.version = LEVEL_CACHE_VERSION;
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.sizeX = level.size.x;
+    header.sizeY = level.size.y;
+    header.tileWidth = level.tileSize.x;
+    header.tileHeight = level.tileSize.y;
+    header.exits = static_cast<uint32_t>(level.exits);
+    header.layerCount = static_cast<uint32_t>(level.layers.size());
+    header.collisionChunkCount = static_cast<uint32_t>(level.collisionMap.Chunks().size());
+    header.objectCount = static_cast<uint32_t>(level.objects.size());
+    header.tilesetCount = static_cast<uint32_t>(level.tilesets.size());
+    Write(file, header);
+
+    for (const ChunkLayer& layer : level.layers) {
+        Write(file, LayerRecord{ layer.offset.x, layer.offset.y, static_cast<uint32_t>(layer.chunks.size()), 0 });
+        for (const Chunk& chunk : layer.chunks) {
+            Write(file, ChunkRecord{ chunk.position.x, chunk.position.y, chunk.size.x, chunk.size.y });
+            for (const tmx::TileLayer::Tile& tile : chunk.tiles) Write(file, TileRecord{ tile.ID, tile.flipFlags });
+        }
+    }
+
+    for (const BitGrid::Chunk& chunk : level.collisionMap.Chunks()) {
+        CollisionRecord record{ chunk.coord.x, chunk.coord.y, {} };
+        std::memcpy(record.rows, chunk.rows.data(), sizeof(record.rows));
+        Write(file, record);
+    }
+
+    for (const ObjectData& object : level.objects) {
+        Write(file, ObjectRecord{ object.position.x, object.position.y, object.size.x, object.size.y,
+            static_cast<uint32_t>(object.type), object.tileGID, object.rotation, object.visible ? 1u : 0u });
+    }
+
+    for (const TilesetInfo& tileset : level.tilesets) {
+        Write(file, TilesetRecord{ tileset.firstGID, tileset.lastGID, tileset.tileCount, tileset.columns,
+            tileset.imageSize.x, tileset.imageSize.y, static_cast<uint32_t>(tileset.imagePath.size()) });
+        file.write(tileset.imagePath.data(), tileset.imagePath.size());
+        const char padding[4] = {};
+        file.write(padding, PaddedLength(tileset.imagePath.size()) - tileset.imagePath.size());
+        file.write(reinterpret_cast<const char*>(tileset.tileMask.data()), tileset.tileMask.size() * sizeof(uint32_t));
+    }
+
+    return static_cast<bool>(file);
+}
+
+static bool ReadLevelCache(CacheReader& reader, const CacheHeader& header, Int2 objectOffset, Level& level) {
+    level.size = Int2(header.sizeX, header.sizeY);
+    level.tileSize = Int2(header.tileWidth, header.tileHeight);
+    level.exits = static_cast<LevelExits>(header.exits);
+
+    if (!reader.CanHold(header.layerCount, sizeof(LayerRecord))) return false;
+    level.layers.reserve(header.layerCount);
+    for (uint32_t i = 0; i < header.layerCount; ++i) {
+        LayerRecord layerRecord;
+        if (!reader.Read(layerRecord)) return false;
+
+        ChunkLayer layer(Vec2(layerRecord.offsetX, layerRecord.offsetY));
+        // Every chunk holds at least one tile
+        if (!reader.CanHold(layerRecord.chunkCount, sizeof(ChunkRecord) + sizeof(TileRecord))) return false;
+        layer.chunks.reserve(layerRecord.chunkCount);
+        for (uint32_t c = 0; c < layerRecord.chunkCount; ++c) {
+            ChunkRecord chunkRecord;
+            if (!reader.Read(chunkRecord) || chunkRecord.width <= 0 || chunkRecord.height <= 0) return false;
+            // ChunkLayer indexes chunks of one size on its chunk grid
+            Int2 position(chunkRecord.x, chunkRecord.y);
+            Int2 size(chunkRecord.width, chunkRecord.height);
+            if (!layer.chunks.empty() && size != layer.chunkSize) return false;
+            if (position % size != Int2::zero || !InChunkRange(FloorDiv(position, size))) return false;
+
+            size_t tileCount = (size_t)chunkRecord.width * chunkRecord.height;
+            const uint8_t* tileData = reader.Take<TileRecord>(tileCount);
+            if (tileData == nullptr) return false;
+
+            Chunk chunk{ position, size, {} };
+            chunk.tiles.resize(tileCount);
+            for (size_t t = 0; t < tileCount; ++t) {
+                TileRecord tile;
+                std::memcpy(&tile, tileData + t * sizeof(TileRecord), sizeof(TileRecord));
+                chunk.tiles[t] = tmx::TileLayer::Tile{ tile.ID, static_cast<uint8_t>(tile.flipFlags) };
+            }
+            layer.AddChunk(std::move(chunk));
+        }
+        level.layers.push_back(std::move(layer));
+    }
+
+    if (!reader.CanHold(header.collisionChunkCount, sizeof(CollisionRecord))) return false;
+    for (uint32_t i = 0; i < header.collisionChunkCount; ++i) {
+        CollisionRecord record;
+        if (!reader.Read(record) || !InChunkRange(Int2(record.x, record.y))) return false;
+        BitGrid::Chunk chunk{ Int2(record.x, record.y) };
+        std::memcpy(chunk.rows.data(), record.rows, sizeof(record.rows));
+        level.collisionMap.AddChunk(chunk);
+    }
+
+    if (!reader.CanHold(header.objectCount, sizeof(ObjectRecord))) return false;
+    level.objects.reserve(header.objectCount);
+    for (uint32_t i = 0; i < header.objectCount; ++i) {
+        ObjectRecord record;
+        if (!reader.Read(record)) return false;
+        // Goals are stamped into a BitGrid
+        if (!InChunkRange(FloorDiv(Int2(record.x, record.y), Int2(BITGRID_CHUNK_SIZE, BITGRID_CHUNK_SIZE)))) return false;
+        level.objects.push_back(ObjectData{
+            Int2(record.x, record.y) + objectOffset,
+            Int2(record.width, record.height),
+            Vec2::zero,
+            static_cast<ObjectType>(record.type),
+
+            record.tileGID,
+            record.rotation,
+            record.visible != 0
+        });
+    }
+
+    if (!reader.CanHold(header.tilesetCount, sizeof(TilesetRecord))) return false;
+    level.tilesets.reserve(header.tilesetCount);
+    for (uint32_t i = 0; i < header.tilesetCount; ++i) {
+        TilesetRecord record;
+        if (!reader.Read(record)) return false;
+
+        const uint8_t* path = reader.Take<char>(PaddedLength(record.pathLength));
+        size_t maskWords = ((size_t)record.tileCount + 31) / 32;
+        const uint8_t* mask = reader.Take<uint32_t>(maskWords);
+        if (path == nullptr || mask == nullptr) return false;
+
+        TilesetInfo tileset;
+        tileset.firstGID = record.firstGID;
+        tileset.lastGID = record.lastGID;
+        tileset.tileCount = record.tileCount;
+        tileset.columns = record.columns;
+        tileset.imageSize = Int2(record.imageWidth, record.imageHeight);
+        tileset.imagePath.assign(reinterpret_cast<const char*>(path), record.pathLength);
+        tileset.tileMask.resize(maskWords);
+        std::memcpy(tileset.tileMask.data(), mask, maskWords * sizeof(uint32_t));
+        level.tilesets.push_back(std::move(tileset));
+    }
+
+    return reader.AtEnd();
+}
+
+Level* LoadLevelCache(const char* cacheFile, const char* tmxFile, Int2 objectOffset) {
+    MappedFile file;
+    if (!file.Open(cacheFile)) return nullptr;
+
+    CacheReader reader(file.Data(), file.Size());
+    CacheHeader header;
+    if (!reader.Read(header)) return nullptr;
+    if (std::memcmp(header.magic, LEVEL_CACHE_MAGIC, sizeof(header.magic)) != 0) return nullptr;
+    if (header.version != LEVEL_CACHE_VERSION) return nullptr;
+
+    SourceStamp stamp = GetSourceStamp(tmxFile);
+    if (stamp.exists && (stamp.size != header.sourceSize || stamp.time != header.sourceTime)) return nullptr;
+
+    Level* level = new Level{};
+    if (!ReadLevelCache(reader, header, objectOffset, *level)) {
+        delete level;
+        return nullptr;
+    }
+    return level;
+}
@@ -1,6 +1,10 @@
 #include <levels.h>
+#include <levelCache.h>
+
+Level* LoadLevel(const char* filename, Int2 objectOffset) {
+    Level* cached = LoadLevelCache(LevelCachePath(filename).c_str(), filename, objectOffset);
+    if (cached != nullptr) return cached;
 
-Level* LoadLevel(const char* filename) {
     tmx::Map map;
     
     if (!map.load(filename)) {
@@ -9,8 +13,28 @@ Level* LoadLevel(const char* filename) {
     }
 
     Level* newLevel = new Level{};
+    LoadLevel(map, *newLevel, objectOffset);
+    return newLevel;
+}
 
+void LoadLevel(const tmx::Map& map, Level& level, Int2 objectOffset) {
     Int2 tileSize(map.getTileSize());
+    level.tileSize = tileSize;
+
+    for (const auto& tileset : map.getTilesets()) {
+        TilesetInfo info;
+        info.firstGID = tileset.getFirstGID();
+        info.lastGID = tileset.getLastGID();
+        info.tileCount = tileset.getTileCount();
+        info.columns = tileset.getColumnCount();
+        info.imageSize = Int2(tileset.getImageSize());
+        info.imagePath = tileset.getImagePath();
+        info.tileMask.assign((info.tileCount + 31) / 32, 0);
+        for (uint32_t i = 0; i < info.tileCount; ++i) {
+            if (tileset.getTile(i) != nullptr) info.tileMask[i >> 5] |= 1u << (i & 31);
+        }
+        level.tilesets.push_back(std::move(info));
+    }
 
     const auto& layers = map.getLayers();
     for (const auto& layer : layers) {
@@ -21,12 +45,12 @@ Level* LoadLevel(const char* filename) {
                 uint32_t tileID = object.getTileID();
                 if (tileID == 0) continue;
 
-                Int2 position = Int2(object.getPosition()) / tileSize + Int2::up;
+                Int2 position = Int2(object.getPosition()) / tileSize + objectOffset;
 
                 ObjectType objType = stringToObjectType(object.getClass());
                 if (objType == ObjectType::Unknown) continue;
 
-                newLevel->objects.push_back(ObjectData{
+                level.objects.push_back(ObjectData{
                     position,
                     tileSize,
                     Vec2::zero,
@@ -49,7 +73,7 @@ Level* LoadLevel(const char* filename) {
                             if (tile.ID != 0) {
                                 int worldX = chunk.position.x + cx;
                                 int worldY = chunk.position.y + cy;
-                                newLevel->collisionMap.insert(Int2{ worldX, worldY });
+                                level.collisionMap.Set(Int2{ worldX, worldY });
                             }
                         }
                     }
@@ -59,7 +83,11 @@ Level* LoadLevel(const char* filename) {
                 Int2 minCorner{ std::numeric_limits<int>::min(), std::numeric_limits<int>::min() };
                 Int2 maxCorner{ std::numeric_limits<int>::max(), std::numeric_limits<int>::max() };
 
-                std::vector<Chunk> chunks;
+                Vec2 offset = Vec2{
+                    (float)tileLayer.getOffset().x,
+                    (float)tileLayer.getOffset().y
+                };
+                ChunkLayer chunkLayer(offset);
                 for (auto& chunk : tileLayer.getChunks()) {
                     Int2 topLeft(chunk.position);
                     Int2 size(chunk.size);
@@ -70,19 +98,40 @@ Level* LoadLevel(const char* filename) {
                     maxCorner.x = std::max(maxCorner.x, botRight.x);
                     maxCorner.y = std::max(maxCorner.y, botRight.y);
 
-                    chunks.push_back(Chunk{ topLeft, size, chunk.tiles });
+                    chunkLayer.AddChunk(Chunk{ topLeft, size, chunk.tiles });
                 }
 
-                newLevel->size = maxCorner - minCorner;
-
-                Vec2 offset = Vec2{
-                    (float)tileLayer.getOffset().x,
-                    (float)tileLayer.getOffset().y
-                };
-                newLevel->layers.push_back(ChunkLayer{chunks, offset});
+                level.size = maxCorner - minCorner;
+                level.layers.push_back(std::move(chunkLayer));
             }
         }
     }
+}
 
-    return newLevel;
+bool CanPlaceLevel(const std::vector<ChunkLayer>& layers, const Level& level, Int2 position) {
+    size_t layerCount = level.layers.size();
+    if (layerCount != layers.size()) return false;
+
+    for (size_t i = 0; i < layerCount; i++) {
+        // Chunks are looked up by their cell on the layer's chunk grid, so a level has to land
+        // on that grid with chunks of the same size or it would take over another chunk's cell
+        Int2 chunkSize = layers[i].chunkSize;
+        if (level.layers[i].chunks.empty() || chunkSize == Int2::zero) continue;
+        if (level.layers[i].chunkSize != chunkSize || position % chunkSize != Int2::zero) return false;
+
+        for (const Chunk& levelChunk : level.layers[i].chunks) {
+            if (layers[i].FindChunk(levelChunk.position + position) != nullptr) return false;
+        }
+    }
+    return true;
+}
+
+void StampLevelLayers(std::vector<ChunkLayer>& layers, const Level& level, Int2 position) {
+    for (size_t i = 0; i < level.layers.size(); i++) {
+        for (const Chunk& levelChunk : level.layers[i].chunks) {
+            Chunk newChunk = levelChunk;
+            newChunk.position += position;
+            layers[i].AddChunk(std::move(newChunk));
+        }
+    }
 }
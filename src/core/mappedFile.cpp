@@ -0,0 +1,89 @@
+#include <mappedFile.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* filename) {
+    Close();
+
+    HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    file = fileHandle;
+    mapping = mappingHandle;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data != nullptr) UnmapViewOfFile(data);
+    if (mapping != nullptr) CloseHandle(mapping);
+    if (file != nullptr) CloseHandle(file);
+    data = nullptr;
+    size = 0;
+    mapping = nullptr;
+    file = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* filename) {
+    Close();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return false;
+
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data != nullptr) munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+    size = 0;
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include <moveHistory.h>
+
+#include <algorithm>
+
+static const Int2& DirectionFromIndex(uint32_t index) {
+    switch (index) {
+    case 0: return Int2::up;
+    case 1: return Int2::down;
+    case 2: return Int2::left;
+    default: return Int2::right;
+    }
+}
+
+static uint32_t DirectionIndex(Int2 direction) {
+    if (direction == Int2::up) return 0;
+    if (direction == Int2::down) return 1;
+    if (direction == Int2::left) return 2;
+    return 3;
+}
+
+// Snapshots use a wide layout so the player can wander off the level for a while
+// before a capture falls outside it and gets skipped
+constexpr int SNAPSHOT_MARGIN = 32;
+
+MoveHistory::MoveHistory(size_t capacity, size_t snapshotInterval)
+    : deltas(std::max<size_t>(capacity, 1)), snapshotInterval(std::max<size_t>(snapshotInterval, 1)),
+    snapshots(std::max<size_t>(capacity, 1) / std::max<size_t>(snapshotInterval, 1) + 2) {}
+
+void MoveHistory::Reset(const GameState& state) {
+    head = 0;
+    count = 0;
+    cursor = 0;
+    base = 0;
+    layout = PackedLayout::Around(state, SNAPSHOT_MARGIN);
+    for (Snapshot& snapshot : snapshots) snapshot.valid = false;
+    TakeSnapshot(state);
+}
+
+void MoveHistory::Record(const GameState& state, const MoveResult& move) {
+    if (!move.moved) return;
+    // A longer chain doesn't fit in a delta, and clamping it would undo the wrong number of
+    // boxes. The move can't be undone, so the history starts over after it.
+    if (move.pushCount > MAX_PUSH_COUNT) {
+        Reset(state);
+        return;
+    }
+
+    // A new move after undoing abandons the redo branch and any snapshots taken on it
+    if (cursor < count) {
+        count = cursor;
+        for (Snapshot& snapshot : snapshots) {
+            if (snapshot.position > Position()) snapshot.valid = false;
+        }
+    }
+    if (count == deltas.size()) {
+        head = (head + 1) % deltas.size();
+        base++;
+        count--;
+        cursor--;
+    }
+
+    DeltaAt(count) = static_cast<Delta>(DirectionIndex(move.direction) | move.pushCount << 2);
+    count++;
+    cursor++;
+    if (Position() % snapshotInterval == 0) TakeSnapshot(state);
+}
+
+bool MoveHistory::Undo(GameState& state) {
+    if (!CanUndo()) return false;
+    cursor--;
+    Apply(state, DeltaAt(cursor), false);
+    return true;
+}
+
+bool MoveHistory::Redo(GameState& state) {
+    if (!CanRedo()) return false;
+    Apply(state, DeltaAt(cursor), true);
+    cursor++;
+    if (Position() % snapshotInterval == 0) TakeSnapshot(state);
+    return true;
+}
+
+bool MoveHistory::Seek(GameState& state, size_t position) {
+    if (position < Oldest() || position > Newest()) return false;
+
+    // Restoring touches every box once, so only jump when that beats stepping there
+    const Snapshot* snapshot = FindSnapshot(position);
+    size_t stepCost = position > Position() ? position - Position() : Position() - position;
+    if (snapshot != nullptr && position - snapshot->position + state.gameObjects.boxes.Size() < stepCost) {
+        if (snapshot->state.Restore(state, layout)) cursor = snapshot->position - base;
+    }
+
+    while (Position() > position) Undo(state);
+    while (Position() < position) Redo(state);
+    return true;
+}
+
+void MoveHistory::TakeSnapshot(const GameState& state) {
+    Snapshot& snapshot = snapshots[(Position() / snapshotInterval) % snapshots.size()];
+    if (snapshot.valid && snapshot.position == Position()) return;
+    snapshot.position = Position();
+    snapshot.valid = PackedState::Capture(state, layout, snapshot.state);
+}
+
+const MoveHistory::Snapshot* MoveHistory::FindSnapshot(size_t position) const {
+    const Snapshot* best = nullptr;
+    for (const Snapshot& snapshot : snapshots) {
+        if (!snapshot.valid || snapshot.position < base || snapshot.position > position) continue;
+        if (best == nullptr || snapshot.position > best->position) best = &snapshot;
+    }
+    return best;
+}
+
+void MoveHistory::Apply(GameState& state, Delta delta, bool forward) {
+    Int2 direction = DirectionFromIndex(delta & 3);
+    int pushCount = delta >> 2;
+
+    if (forward) {
+        // Far end of the chain first, as in GameState::Move
+        for (int i = pushCount; i > 0; --i) {
+            Int2 boxPos = state.playerPos + direction * i;
+            state.MoveBox(boxPos, boxPos + direction);
+        }
+        state.playerPos += direction;
+    }
+    else {
+        // Near end first, each box steps back into the cell the one before it left
+        for (int i = 1; i <= pushCount; ++i) {
+            Int2 boxPos = state.playerPos + direction * i;
+            state.MoveBox(boxPos, boxPos - direction);
+        }
+        state.playerPos -= direction;
+    }
+}
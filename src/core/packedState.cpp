@@ -0,0 +1,117 @@
+#include <packedState.h>
+
+#include <algorithm>
+#include <bit>
+
+static uint64_t CellKey(uint32_t index, uint64_t kind) {
+    return Mix64(static_cast<uint64_t>(index) << 1 | kind);
+}
+
+static uint64_t BoxKey(uint32_t index) { return CellKey(index, 0); }
+static uint64_t PlayerKey(uint32_t index) { return CellKey(index, 1); }
+
+PackedLayout PackedLayout::Around(const GameState& state, int margin) {
+    Int2 minCell = state.playerPos;
+    Int2 maxCell = state.playerPos;
+    auto extend = [&](Int2 cell) {
+        minCell = Int2(std::min(minCell.x, cell.x), std::min(minCell.y, cell.y));
+        maxCell = Int2(std::max(maxCell.x, cell.x), std::max(maxCell.y, cell.y));
+    };
+    for (Int2 box : state.gameObjects.boxes.position) extend(box);
+    for (const BitGrid::Chunk& chunk : state.goals.Chunks()) {
+        for (int y = 0; y < BITGRID_CHUNK_SIZE; ++y) {
+            if (chunk.rows[y] == 0) continue;
+            int first = std::countr_zero(static_cast<uint32_t>(chunk.rows[y]));
+            int last = 31 - std::countl_zero(static_cast<uint32_t>(chunk.rows[y]));
+            Int2 origin = chunk.coord * BITGRID_CHUNK_SIZE;
+            extend(origin + Int2(first, y));
+            extend(origin + Int2(last, y));
+        }
+    }
+
+    margin = std::max(margin, 0);
+    PackedLayout layout;
+    layout.origin = minCell - Int2(margin, margin);
+    layout.width = maxCell.x - minCell.x + 1 + margin * 2;
+    layout.height = maxCell.y - minCell.y + 1 + margin * 2;
+    return layout;
+}
+
+bool PackedState::Capture(const GameState& state, const PackedLayout& layout, PackedState& out) {
+    if (!layout.Contains(state.playerPos)) return false;
+    for (Int2 box : state.gameObjects.boxes.position) {
+        if (!layout.Contains(box)) return false;
+    }
+
+    out.words.Assign(layout.WordCount(), 0);
+    out.boxHash = 0;
+    for (Int2 box : state.gameObjects.boxes.position) out.SetBox(layout.Index(box));
+    out.player = layout.Index(state.playerPos);
+    return true;
+}
+
+bool PackedState::Restore(GameState& state, const PackedLayout& layout) const {
+    if (state.gameObjects.boxes.Size() != BoxCount()) return false;
+
+    std::vector<Int2> vacated;
+    for (Int2 box : state.gameObjects.boxes.position) {
+        if (!layout.Contains(box) || !HasBox(layout.Index(box))) vacated.push_back(box);
+    }
+    std::vector<Int2> arrivals;
+    for (size_t w = 0; w < words.Size(); ++w) {
+        uint64_t word = words[w];
+        while (word) {
+            uint32_t index = static_cast<uint32_t>(w * 64 + std::countr_zero(word));
+            word &= word - 1;
+            Int2 cell = layout.Cell(index);
+            if (!state.HasBox(cell)) arrivals.push_back(cell);
+        }
+    }
+
+    for (size_t i = 0; i < vacated.size(); ++i) state.MoveBox(vacated[i], arrivals[i]);
+    state.playerPos = layout.Cell(player);
+    return true;
+}
+
+void PackedState::SetBox(uint32_t index) {
+    if (HasBox(index)) return;
+    words[index >> 6] |= 1ull << (index & 63);
+    boxHash ^= BoxKey(index);
+}
+
+void PackedState::ResetBox(uint32_t index) {
+    if (!HasBox(index)) return;
+    words[index >> 6] &= ~(1ull << (index & 63));
+    boxHash ^= BoxKey(index);
+}
+
+uint64_t PackedState::GetHash() const {
+    return boxHash ^ PlayerKey(player);
+}
+
+size_t PackedState::BoxCount() const {
+    size_t count = 0;
+    for (uint64_t word : words) count += std::popcount(word);
+    return count;
+}
+
+uint32_t PackedStateStore::Add(const PackedState& state) {
+    uint32_t id = static_cast<uint32_t>(Size());
+    data.push_back(state.boxHash);
+    data.push_back(state.player);
+    data.insert(data.end(), state.words.begin(), state.words.end());
+    return id;
+}
+
+PackedState PackedStateStore::Get(uint32_t id) const {
+    const uint64_t* entry = data.data() + (size_t)id * Stride();
+    PackedState state;
+    state.boxHash = entry[0];
+    state.player = static_cast<uint32_t>(entry[1]);
+    state.words.Assign(entry + 2, entry + Stride());
+    return state;
+}
+
+void PackedStateStore::Truncate(size_t count) {
+    if (count < Size()) data.resize(count * Stride());
+}
@@ -0,0 +1,272 @@
+#include <replay.h>
+#include <moveHistory.h>
+
+#include <fstream>
+
+// File layout, little endian: magic and version, the level paths with the base map first,
+// the player start, then each event as its step, type and payload, and the final checksum
+constexpr char REPLAY_MAGIC[4] = { 'S', 'K', 'R', 'P' };
+constexpr uint32_t REPLAY_VERSION = 1;
+
+static uint64_t MixCell(Int2 cell, uint64_t kind) {
+    return Mix64((static_cast<uint64_t>(static_cast<uint32_t>(cell.x)) << 32 | static_cast<uint32_t>(cell.y)) ^ kind);
+}
+
+static uint8_t DirectionIndex(Int2 direction) {
+    if (direction == Int2::up) return 0;
+    if (direction == Int2::down) return 1;
+    if (direction == Int2::left) return 2;
+    return 3;
+}
+
+static Int2 DirectionFromIndex(uint8_t index) {
+    switch (index & 3) {
+    case 0: return Int2::up;
+    case 1: return Int2::down;
+    case 2: return Int2::left;
+    default: return Int2::right;
+    }
+}
+
+uint64_t StateChecksum(const GameState& state) {
+    uint64_t checksum = MixCell(state.playerPos, 0x5A5A5A5A5A5A5A5Aull);
+    for (Int2 box : state.gameObjects.boxes.position) checksum ^= MixCell(box, 0);
+    return checksum;
+}
+
+template<typename T>
+static void Write(std::ofstream& file, T value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool Read(std::ifstream& file, T& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool SaveReplay(const Replay& replay, const char* filename) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) return false;
+
+    file.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    Write<uint32_t>(file, REPLAY_VERSION);
+
+    Write<uint32_t>(file, static_cast<uint32_t>(replay.levelPaths.size() + 1));
+    auto writePath = [&](const std::string& path) {
+        Write<uint16_t>(file, static_cast<uint16_t>(path.size()));
+        file.write(path.data(), path.size());
+    };
+    writePath(replay.baseMap);
+    for (const std::string& path : replay.levelPaths) writePath(path);
+
+    Write<int32_t>(file, replay.playerStart.x);
+    Write<int32_t>(file, replay.playerStart.y);
+
+    Write<uint32_t>(file, static_cast<uint32_t>(replay.events.size()));
+    for (const ReplayEvent& event : replay.events) {
+        Write<uint32_t>(file, event.step);
+        Write<uint8_t>(file, static_cast<uint8_t>(event.type));
+        switch (event.type) {
+        case ReplayEventType::Move:
+            Write<uint8_t>(file, DirectionIndex(event.direction) | (event.moved ? 4 : 0));
+            break;
+        case ReplayEventType::AddLevel:
+            Write<uint32_t>(file, event.level);
+            Write<int32_t>(file, event.position.x);
+            Write<int32_t>(file, event.position.y);
+            break;
+        default:
+            break;
+        }
+    }
+
+    Write<uint64_t>(file, replay.finalChecksum);
+    return static_cast<bool>(file);
+}
+
+bool LoadReplay(const char* filename, Replay& replay) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    if (!file.read(magic, sizeof(magic)) || !Read(file, version)) return false;
+    if (std::char_traits<char>::compare(magic, REPLAY_MAGIC, 4) != 0 || version != REPLAY_VERSION) return false;
+
+    replay = Replay{};
+    uint32_t pathCount = 0;
+    if (!Read(file, pathCount) || pathCount == 0) return false;
+    for (uint32_t i = 0; i < pathCount; ++i) {
+        uint16_t length = 0;
+        if (!Read(file, length)) return false;
+        std::string path(length, '\0');
+        if (!file.read(path.data(), length)) return false;
+        if (i == 0) replay.baseMap = std::move(path);
+        else replay.levelPaths.push_back(std::move(path));
+    }
+
+    int32_t startX = 0, startY = 0;
+    if (!Read(file, startX) || !Read(file, startY)) return false;
+    replay.playerStart = Int2(startX, startY);
+
+    uint32_t eventCount = 0;
+    if (!Read(file, eventCount)) return false;
+    // Events are appended as they are read, a corrupt count then fails the read instead of
+    // the allocation
+    for (uint32_t i = 0; i < eventCount; ++i) {
+        ReplayEvent event;
+        uint8_t type = 0;
+        if (!Read(file, event.step) || !Read(file, type)) return false;
+        event.type = static_cast<ReplayEventType>(type);
+        switch (event.type) {
+        case ReplayEventType::Move: {
+            uint8_t packed = 0;
+            if (!Read(file, packed)) return false;
+            event.direction = DirectionFromIndex(packed);
+            event.moved = (packed & 4) != 0;
+            break;
+        }
+        case ReplayEventType::AddLevel: {
+            int32_t x = 0, y = 0;
+            if (!Read(file, event.level) || !Read(file, x) || !Read(file, y)) return false;
+            if (event.level >= replay.levelPaths.size()) return false;
+            event.position = Int2(x, y);
+            break;
+        }
+        case ReplayEventType::Undo:
+        case ReplayEventType::Redo:
+            break;
+        default:
+            return false;
+        }
+        replay.events.push_back(event);
+    }
+
+    return Read(file, replay.finalChecksum);
+}
+
+void ReplayRecorder::Begin(const std::string& baseMap, Int2 playerStart) {
+    replay = Replay{};
+    replay.baseMap = baseMap;
+    replay.playerStart = playerStart;
+}
+
+void ReplayRecorder::RecordMove(uint32_t step, Int2 direction, bool moved) {
+    if (!moved && !replay.events.empty()) {
+        const ReplayEvent& last = replay.events.back();
+        if (last.type == ReplayEventType::Move && !last.moved && last.direction == direction) return;
+    }
+
+    ReplayEvent event;
+    event.type = ReplayEventType::Move;
+    event.step = step;
+    event.direction = direction;
+    event.moved = moved;
+    replay.events.push_back(event);
+}
+
+void ReplayRecorder::RecordAddLevel(uint32_t step, const std::string& path, Int2 position) {
+    uint32_t level = 0;
+    while (level < replay.levelPaths.size() && replay.levelPaths[level] != path) level++;
+    if (level == replay.levelPaths.size()) replay.levelPaths.push_back(path);
+
+    ReplayEvent event;
+    event.type = ReplayEventType::AddLevel;
+    event.step = step;
+    event.level = level;
+    event.position = position;
+    replay.events.push_back(event);
+}
+
+void ReplayRecorder::RecordUndo(uint32_t step) {
+    ReplayEvent event;
+    event.type = ReplayEventType::Undo;
+    event.step = step;
+    replay.events.push_back(event);
+}
+
+void ReplayRecorder::RecordRedo(uint32_t step) {
+    ReplayEvent event;
+    event.type = ReplayEventType::Redo;
+    event.step = step;
+    replay.events.push_back(event);
+}
+
+const Replay& ReplayRecorder::Finish(const GameState& state) {
+    replay.finalChecksum = StateChecksum(state);
+    return replay;
+}
+
+const Level* ReplayRunner::GetLevel(std::unordered_map<std::string, std::unique_ptr<Level>>& cache,
+    const std::string& path, Int2 objectOffset) {
+    auto it = cache.find(path);
+    if (it != cache.end()) return it->second.get();
+
+    Level* level = LoadLevel(path.c_str(), objectOffset);
+    if (level == nullptr) return nullptr;
+    return cache.emplace(path, std::unique_ptr<Level>(level)).first->second.get();
+}
+
+bool ReplayRunner::Run(const Replay& replay, PlaybackResult& result, GameState* finalState) {
+    result = PlaybackResult{};
+
+    // The base map keeps the object offset Tilemap::LoadTilemap has always used
+    const Level* baseMap = GetLevel(baseMaps, replay.baseMap, Int2::down);
+    if (baseMap == nullptr) return false;
+
+    // Levels are placed against the stamped tile layers the way Tilemap::AddLevel does
+    std::vector<ChunkLayer> layers = baseMap->layers;
+    GameState state;
+    state.AddLevel(*baseMap, Int2::zero);
+    state.playerPos = replay.playerStart;
+
+    MoveHistory history;
+    history.Reset(state);
+
+    for (size_t i = 0; i < replay.events.size(); ++i) {
+        const ReplayEvent& event = replay.events[i];
+        switch (event.type) {
+        case ReplayEventType::Move: {
+            MoveResult move = state.Move(event.direction);
+            if (move.moved) {
+                history.Record(state, move);
+                result.movesApplied++;
+            }
+            else result.movesRefused++;
+
+            if (move.moved != event.moved) {
+                if (result.divergences == 0) result.firstDivergence = i;
+                result.divergences++;
+            }
+            break;
+        }
+        case ReplayEventType::AddLevel: {
+            const Level* level = GetLevel(levels, replay.levelPaths[event.level], Int2::up);
+            if (level == nullptr) return false;
+            if (!CanPlaceLevel(layers, *level, event.position)) break;
+            StampLevelLayers(layers, *level, event.position);
+            state.AddLevel(*level, event.position);
+            history.Reset(state);
+            break;
+        }
+        case ReplayEventType::Undo:
+            history.Undo(state);
+            break;
+        case ReplayEventType::Redo:
+            history.Redo(state);
+            break;
+        }
+        result.eventsApplied++;
+    }
+
+    result.checksum = StateChecksum(state);
+    result.checksumMatches = replay.finalChecksum == 0 || replay.finalChecksum == result.checksum;
+    if (finalState != nullptr) *finalState = std::move(state);
+    return true;
+}
+
+bool ReplayPlayer::Next(uint32_t step, ReplayEvent& event) {
+    if (Finished() || replay.events[nextEvent].step > step) return false;
+    event = replay.events[nextEvent++];
+    return true;
+}
@@ -0,0 +1,862 @@
+#include <solver.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t NO_BOX = 0xFFFFFFFF;
+constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+constexpr uint32_t UNREACHABLE = 0xFFFFFFFF;
+// Boards past this many cells are almost certainly an open world rather than a puzzle
+constexpr size_t MAX_BOARD_CELLS = 1 << 24;
+
+Int2 Direction(int d) {
+    switch (d) {
+    case 0: return Int2::up;
+    case 1: return Int2::down;
+    case 2: return Int2::left;
+    default: return Int2::right;
+    }
+}
+
+uint64_t SplitMix64(uint64_t& seed) {
+    uint64_t z = Mix64(seed);
+    seed += 0x9E3779B97F4A7C15ull;
+    return z;
+}
+
+struct PushMove {
+    uint32_t box;
+    uint32_t from;
+    uint8_t dir;
+};
+
+// The searched region flattened to cell indices, with a ring of wall around it so
+// neighbour lookups never need a bounds check
+struct Board {
+    Int2 origin = Int2::zero;
+    int width = 0;
+    int height = 0;
+    int offsets[4] = {};
+    std::vector<uint8_t> walls;
+    std::vector<uint8_t> goals;
+    // Fewest pushes from each cell to any goal, ignoring other boxes
+    std::vector<uint32_t> goalDistance;
+    std::vector<uint64_t> boxKeys;
+    std::vector<uint64_t> playerKeys;
+
+    uint32_t Index(Int2 cell) const {
+        return static_cast<uint32_t>((cell.x - origin.x) + (cell.y - origin.y) * width);
+    }
+};
+
+void ForEachCell(const BitGrid& grid, auto&& func) {
+    for (const BitGrid::Chunk& chunk : grid.Chunks()) {
+        for (int y = 0; y < BITGRID_CHUNK_SIZE; ++y) {
+            BitGrid::Row row = chunk.rows[y];
+            while (row) {
+                int x = std::countr_zero(static_cast<uint32_t>(row));
+                row &= row - 1;
+                func(Int2(chunk.coord.x * BITGRID_CHUNK_SIZE + x, chunk.coord.y * BITGRID_CHUNK_SIZE + y));
+            }
+        }
+    }
+}
+
+// The board is the region the player can walk to, flood filled over the collision map with
+// boxes counted as floor since they can be pushed out of the way. Boxes never leave that
+// region, so every cell outside it is wall. The flood stops margin cells past the bounding
+// box of the player, boxes and goals to keep open drafted worlds finite; clipped reports
+// whether that cut off any open cell, in which case an exhausted search proves nothing.
+SolveStatus BuildBoard(const GameState& state, int margin, bool requireGoals, Board& board,
+    std::vector<uint32_t>& boxes, uint32_t& player, bool& clipped) {
+    clipped = false;
+    if (requireGoals && (state.goals.Empty() || state.goals.Count() < state.gameObjects.boxes.Size())) {
+        return SolveStatus::InvalidBoard;
+    }
+    if (state.IsSolid(state.playerPos)) return SolveStatus::InvalidBoard;
+
+    Int2 minCell = state.playerPos;
+    Int2 maxCell = state.playerPos;
+    auto extend = [&](Int2 cell) {
+        minCell = Int2(std::min(minCell.x, cell.x), std::min(minCell.y, cell.y));
+        maxCell = Int2(std::max(maxCell.x, cell.x), std::max(maxCell.y, cell.y));
+    };
+    for (Int2 box : state.gameObjects.boxes.position) extend(box);
+    ForEachCell(state.goals, extend);
+
+    int pad = std::max(margin, 0);
+    Int2 capOrigin = minCell - Int2(pad, pad);
+    int capWidth = maxCell.x - minCell.x + 1 + pad * 2;
+    int capHeight = maxCell.y - minCell.y + 1 + pad * 2;
+    if ((size_t)capWidth * capHeight > MAX_BOARD_CELLS) return SolveStatus::LimitReached;
+
+    auto inCap = [&](Int2 cell) {
+        return cell.x >= capOrigin.x && cell.y >= capOrigin.y
+            && cell.x < capOrigin.x + capWidth && cell.y < capOrigin.y + capHeight;
+    };
+    auto capIndex = [&](Int2 cell) {
+        return (size_t)(cell.x - capOrigin.x) + (size_t)(cell.y - capOrigin.y) * capWidth;
+    };
+
+    std::vector<uint8_t> reached((size_t)capWidth * capHeight, 0);
+    std::vector<Int2> flood = { state.playerPos };
+    reached[capIndex(state.playerPos)] = 1;
+    Int2 reachMin = minCell;
+    Int2 reachMax = maxCell;
+    for (size_t head = 0; head < flood.size(); ++head) {
+        Int2 cell = flood[head];
+        reachMin = Int2(std::min(reachMin.x, cell.x), std::min(reachMin.y, cell.y));
+        reachMax = Int2(std::max(reachMax.x, cell.x), std::max(reachMax.y, cell.y));
+        for (int d = 0; d < 4; ++d) {
+            Int2 next = cell + Direction(d);
+            if (state.IsSolid(next)) continue;
+            if (!inCap(next)) {
+                clipped = true;
+                continue;
+            }
+            uint8_t& seen = reached[capIndex(next)];
+            if (seen) continue;
+            seen = 1;
+            flood.push_back(next);
+        }
+    }
+
+    // One ring of wall around the region so neighbour lookups never need a bounds check
+    board.origin = reachMin - Int2::one;
+    board.width = reachMax.x - reachMin.x + 3;
+    board.height = reachMax.y - reachMin.y + 3;
+    size_t cellCount = (size_t)board.width * board.height;
+
+    for (int d = 0; d < 4; ++d) {
+        Int2 dir = Direction(d);
+        board.offsets[d] = dir.x + dir.y * board.width;
+    }
+
+    board.walls.assign(cellCount, 1);
+    board.goals.assign(cellCount, 0);
+    for (Int2 cell : flood) board.walls[board.Index(cell)] = 0;
+    // Boxes and goals the player can't walk to still sit on open cells, they just never move
+    // or get filled
+    for (Int2 box : state.gameObjects.boxes.position) {
+        if (!state.IsSolid(box)) board.walls[board.Index(box)] = 0;
+    }
+    ForEachCell(state.goals, [&](Int2 cell) {
+        board.goals[board.Index(cell)] = 1;
+        if (!state.IsSolid(cell)) board.walls[board.Index(cell)] = 0;
+    });
+
+    boxes.clear();
+    for (Int2 box : state.gameObjects.boxes.position) {
+        uint32_t cell = board.Index(box);
+        if (board.walls[cell]) return SolveStatus::InvalidBoard;
+        boxes.push_back(cell);
+    }
+    std::sort(boxes.begin(), boxes.end());
+
+    player = board.Index(state.playerPos);
+    if (board.walls[player] || std::binary_search(boxes.begin(), boxes.end(), player)) {
+        return SolveStatus::InvalidBoard;
+    }
+
+    // Pull every goal backwards: a box at p reaches t = p + d when both t and the
+    // cell the player pushes from, p - d, are open
+    board.goalDistance.assign(cellCount, UNREACHABLE);
+    std::vector<uint32_t> queue;
+    for (uint32_t cell = 0; cell < cellCount; ++cell) {
+        if (board.goals[cell] && !board.walls[cell]) {
+            board.goalDistance[cell] = 0;
+            queue.push_back(cell);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        uint32_t target = queue[head];
+        for (int d = 0; d < 4; ++d) {
+            uint32_t from = target - board.offsets[d];
+            if (board.walls[from] || board.goalDistance[from] != UNREACHABLE) continue;
+            if (board.walls[from - board.offsets[d]]) continue;
+            board.goalDistance[from] = board.goalDistance[target] + 1;
+            queue.push_back(from);
+        }
+    }
+
+    uint64_t seed = 0x5EED5EED5EED5EEDull;
+    board.boxKeys.resize(cellCount);
+    board.playerKeys.resize(cellCount);
+    for (size_t i = 0; i < cellCount; ++i) {
+        board.boxKeys[i] = SplitMix64(seed);
+        board.playerKeys[i] = SplitMix64(seed);
+    }
+
+    return SolveStatus::Solved;
+}
+
+// Open addressing table from a state's hash to its node, probing linearly
+class TranspositionTable {
+public:
+    struct Entry {
+        uint64_t key = 0;
+        uint32_t node = NO_NODE;
+    };
+
+    TranspositionTable() : entries(1 << 16) {}
+
+    // Returns the entry holding a node equal to the state, or the empty entry to fill in
+    template<typename Equals>
+    Entry& Find(uint64_t key, Equals&& equals) {
+        size_t mask = entries.size() - 1;
+        for (size_t i = key & mask;; i = (i + 1) & mask) {
+            Entry& entry = entries[i];
+            if (entry.node == NO_NODE) return entry;
+            if (entry.key == key && equals(entry.node)) return entry;
+        }
+    }
+
+    void Insert(Entry& slot, uint64_t key, uint32_t node) {
+        slot.key = key;
+        slot.node = node;
+        if (++count * 2 >= entries.size()) Grow();
+    }
+
+private:
+    std::vector<Entry> entries;
+    size_t count = 0;
+
+    void Grow() {
+        std::vector<Entry> old = std::move(entries);
+        entries.assign(old.size() * 2, Entry{});
+        size_t mask = entries.size() - 1;
+        for (const Entry& entry : old) {
+            if (entry.node == NO_NODE) continue;
+            size_t i = entry.key & mask;
+            while (entries[i].node != NO_NODE) i = (i + 1) & mask;
+            entries[i] = entry;
+        }
+    }
+};
+
+// Per thread scratch for flooding player reach and listing the legal pushes of a state
+class PushGenerator {
+public:
+    PushGenerator(const Board& board, size_t boxCount, bool pruneDeadlocks = true)
+        : board(board), boxCount(boxCount), pruneDeadlocks(pruneDeadlocks),
+        boxAt(board.walls.size(), NO_BOX), visited(board.walls.size(), 0), parentDir(board.walls.size(), 0) {}
+
+    void PlaceBoxes(const uint32_t* boxes) {
+        for (size_t i = 0; i < boxCount; ++i) boxAt[boxes[i]] = static_cast<uint32_t>(i);
+    }
+
+    void LiftBoxes(const uint32_t* boxes) {
+        for (size_t i = 0; i < boxCount; ++i) boxAt[boxes[i]] = NO_BOX;
+    }
+
+    void NextVisitStamp() {
+        if (++visitStamp == 0) {
+            std::fill(visited.begin(), visited.end(), 0);
+            visitStamp = 1;
+        }
+    }
+
+    // Floods the cells the player can walk to around the placed boxes and returns the
+    // lowest index among them, which stands in for the player in the state key
+    uint32_t Reach(uint32_t player) {
+        NextVisitStamp();
+        queue.clear();
+        queue.push_back(player);
+        visited[player] = visitStamp;
+        uint32_t top = player;
+
+        for (size_t head = 0; head < queue.size(); ++head) {
+            uint32_t cell = queue[head];
+            top = std::min(top, cell);
+            for (int d = 0; d < 4; ++d) {
+                uint32_t next = cell + board.offsets[d];
+                if (visited[next] == visitStamp || board.walls[next] || boxAt[next] != NO_BOX) continue;
+                visited[next] = visitStamp;
+                queue.push_back(next);
+            }
+        }
+        return top;
+    }
+
+    bool IsBlocked(uint32_t cell) const {
+        return board.walls[cell] || boxAt[cell] != NO_BOX;
+    }
+
+    // A box that just landed in a 2x2 block of walls and boxes can never move again,
+    // which is only fine if every box in the block is already on a goal
+    bool IsFrozen(uint32_t cell) const {
+        int w = board.width;
+        for (int dy = -1; dy <= 0; ++dy) {
+            for (int dx = -1; dx <= 0; ++dx) {
+                uint32_t corner = cell + dx + dy * w;
+                uint32_t block[4] = { corner, corner + 1, corner + w, corner + w + 1 };
+                bool frozen = true;
+                bool offGoal = false;
+                for (uint32_t c : block) {
+                    if (!IsBlocked(c)) { frozen = false; break; }
+                    if (boxAt[c] != NO_BOX && !board.goals[c]) offGoal = true;
+                }
+                if (frozen && offGoal) return true;
+            }
+        }
+        return false;
+    }
+
+    void GeneratePushes(const uint32_t* boxes, uint32_t player, std::vector<PushMove>& pushes) {
+        pushes.clear();
+        PlaceBoxes(boxes);
+        Reach(player);
+
+        for (uint32_t i = 0; i < boxCount; ++i) {
+            uint32_t from = boxes[i];
+            for (int d = 0; d < 4; ++d) {
+                if (visited[from - board.offsets[d]] != visitStamp) continue;
+                uint32_t to = from + board.offsets[d];
+                if (IsBlocked(to)) continue;
+                if (!pruneDeadlocks) {
+                    pushes.push_back(PushMove{ i, from, static_cast<uint8_t>(d) });
+                    continue;
+                }
+                if (board.goalDistance[to] == UNREACHABLE) continue;
+
+                boxAt[from] = NO_BOX;
+                boxAt[to] = i;
+                bool frozen = IsFrozen(to);
+                boxAt[to] = NO_BOX;
+                boxAt[from] = i;
+                if (!frozen) pushes.push_back(PushMove{ i, from, static_cast<uint8_t>(d) });
+            }
+        }
+
+        LiftBoxes(boxes);
+    }
+
+    // Writes the boxes after the push, kept sorted, and returns the normalized player cell
+    uint32_t ApplyPush(const uint32_t* boxes, const PushMove& push, uint32_t* out) {
+        std::copy(boxes, boxes + boxCount, out);
+        uint32_t to = push.from + board.offsets[push.dir];
+        size_t i = push.box;
+        out[i] = to;
+        while (i > 0 && out[i - 1] > out[i]) { std::swap(out[i - 1], out[i]); --i; }
+        while (i + 1 < boxCount && out[i + 1] < out[i]) { std::swap(out[i + 1], out[i]); ++i; }
+
+        PlaceBoxes(out);
+        uint32_t player = Reach(push.from);
+        LiftBoxes(out);
+        return player;
+    }
+
+protected:
+    const Board& board;
+    size_t boxCount = 0;
+    bool pruneDeadlocks = true;
+
+    std::vector<uint32_t> boxAt;
+    std::vector<uint32_t> visited;
+    uint32_t visitStamp = 0;
+    std::vector<uint8_t> parentDir;
+    std::vector<uint32_t> queue;
+};
+
+class Search : PushGenerator {
+public:
+    Search(const Board& board, size_t boxCount, const SolverOptions& options, SolveResult& result)
+        : PushGenerator(board, boxCount), options(options), result(result) {}
+
+    void Run(const std::vector<uint32_t>& startBoxes, uint32_t startPlayer) {
+        uint64_t boxHash = 0;
+        uint32_t h = 0;
+        for (uint32_t cell : startBoxes) {
+            boxHash ^= board.boxKeys[cell];
+            if (board.goalDistance[cell] == UNREACHABLE) {
+                result.status = SolveStatus::Unsolvable;
+                return;
+            }
+            h += board.goalDistance[cell];
+        }
+
+        PlaceBoxes(startBoxes.data());
+        uint32_t player = Reach(startPlayer);
+        LiftBoxes(startBoxes.data());
+
+        std::vector<PushMove> solution;
+        if (options.algorithm == SolverAlgorithm::AStar) {
+            result.status = AStar(startBoxes, player, boxHash, h, solution);
+        }
+        else {
+            result.status = IDAStar(startBoxes, player, boxHash, h, solution);
+        }
+
+        if (result.status == SolveStatus::Solved) {
+            BuildMoves(startBoxes, startPlayer, solution);
+        }
+    }
+
+private:
+    struct Node {
+        uint64_t boxHash;
+        uint32_t player;
+        uint32_t parent;
+        uint32_t g;
+        uint32_t h;
+        uint32_t pushFrom;
+        uint8_t pushDir;
+        bool closed;
+    };
+
+    struct OpenEntry {
+        uint32_t f;
+        uint32_t g;
+        uint32_t node;
+
+        // Lowest f first, deeper nodes first among ties
+        bool operator<(const OpenEntry& other) const {
+            if (f != other.f) return f > other.f;
+            return g < other.g;
+        }
+    };
+
+    struct VisitRecord {
+        uint32_t g;
+        uint32_t iteration;
+    };
+
+    const SolverOptions& options;
+    SolveResult& result;
+
+    SolveStatus AStar(const std::vector<uint32_t>& startBoxes, uint32_t startPlayer, uint64_t startHash,
+        uint32_t startH, std::vector<PushMove>& solution) {
+        std::vector<Node> nodes;
+        std::vector<uint32_t> nodeBoxes;
+        TranspositionTable table;
+        std::priority_queue<OpenEntry> open;
+        std::vector<uint32_t> current(boxCount);
+        std::vector<uint32_t> child(boxCount);
+        std::vector<PushMove> pushes;
+
+        auto addNode = [&](const uint32_t* boxes, const Node& node) {
+            uint32_t index = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(node);
+            nodeBoxes.insert(nodeBoxes.end(), boxes, boxes + boxCount);
+            result.nodesGenerated++;
+            return index;
+        };
+
+        uint32_t root = addNode(startBoxes.data(), Node{ startHash, startPlayer, NO_NODE, 0, startH, 0, 0, false });
+        uint64_t rootKey = startHash ^ board.playerKeys[startPlayer];
+        table.Insert(table.Find(rootKey, [](uint32_t) { return false; }), rootKey, root);
+        open.push(OpenEntry{ startH, 0, root });
+
+        while (!open.empty()) {
+            OpenEntry entry = open.top();
+            open.pop();
+
+            Node node = nodes[entry.node];
+            if (node.closed || entry.g != node.g) continue;
+            nodes[entry.node].closed = true;
+            result.nodesExpanded++;
+
+            if (node.h == 0) {
+                for (uint32_t n = entry.node; nodes[n].parent != NO_NODE; n = nodes[n].parent) {
+                    solution.push_back(PushMove{ 0, nodes[n].pushFrom, nodes[n].pushDir });
+                }
+                std::reverse(solution.begin(), solution.end());
+                return SolveStatus::Solved;
+            }
+            if (nodes.size() >= options.maxNodes) return SolveStatus::LimitReached;
+
+            std::copy_n(nodeBoxes.begin() + (size_t)entry.node * boxCount, boxCount, current.begin());
+            GeneratePushes(current.data(), node.player, pushes);
+
+            for (const PushMove& push : pushes) {
+                uint32_t to = push.from + board.offsets[push.dir];
+                uint32_t player = ApplyPush(current.data(), push, child.data());
+                uint64_t boxHash = node.boxHash ^ board.boxKeys[push.from] ^ board.boxKeys[to];
+                uint64_t key = boxHash ^ board.playerKeys[player];
+                uint32_t g = node.g + 1;
+                uint32_t h = node.h - board.goalDistance[push.from] + board.goalDistance[to];
+
+                auto& slot = table.Find(key, [&](uint32_t other) {
+                    return nodes[other].player == player &&
+                        std::equal(child.begin(), child.end(), nodeBoxes.begin() + (size_t)other * boxCount);
+                });
+
+                if (slot.node != NO_NODE) {
+                    // The heuristic is consistent so closed nodes already have their best cost
+                    Node& existing = nodes[slot.node];
+                    if (existing.closed || g >= existing.g) continue;
+                    existing.g = g;
+                    existing.parent = entry.node;
+                    existing.pushFrom = push.from;
+                    existing.pushDir = push.dir;
+                    open.push(OpenEntry{ g + h, g, slot.node });
+                    continue;
+                }
+
+                uint32_t index = addNode(child.data(), Node{ boxHash, player, entry.node, g, h, push.from, push.dir, false });
+                table.Insert(slot, key, index);
+                open.push(OpenEntry{ g + h, g, index });
+            }
+        }
+
+        return SolveStatus::Unsolvable;
+    }
+
+    SolveStatus IDAStar(const std::vector<uint32_t>& startBoxes, uint32_t startPlayer, uint64_t startHash,
+        uint32_t startH, std::vector<PushMove>& solution) {
+        // Per depth scratch, a deque so references survive the search growing deeper
+        std::deque<std::vector<uint32_t>> depthBoxes;
+        std::deque<std::vector<PushMove>> depthPushes;
+        std::unordered_map<uint64_t, VisitRecord> table;
+        uint32_t iteration = 0;
+        uint32_t threshold = startH;
+        uint32_t nextThreshold = UNREACHABLE;
+        bool limitReached = false;
+
+        depthBoxes.emplace_back(startBoxes);
+
+        auto search = [&](auto& self, size_t depth, uint32_t player, uint64_t boxHash, uint32_t g, uint32_t h) -> bool {
+            uint32_t f = g + h;
+            if (f > threshold) {
+                nextThreshold = std::min(nextThreshold, f);
+                return false;
+            }
+            if (h == 0) return true;
+            if (result.nodesExpanded >= options.maxNodes) {
+                limitReached = true;
+                return false;
+            }
+
+            // Only hashes are compared here, a 64 bit collision merely prunes one branch
+            auto [it, inserted] = table.try_emplace(boxHash ^ board.playerKeys[player], VisitRecord{ g, iteration });
+            if (!inserted) {
+                if (it->second.iteration == iteration && it->second.g <= g) return false;
+                it->second = VisitRecord{ g, iteration };
+            }
+            result.nodesExpanded++;
+
+            if (depthBoxes.size() <= depth + 1) depthBoxes.emplace_back(boxCount);
+            if (depthPushes.size() <= depth) depthPushes.emplace_back();
+
+            const std::vector<uint32_t>& boxes = depthBoxes[depth];
+            std::vector<PushMove>& pushes = depthPushes[depth];
+            GeneratePushes(boxes.data(), player, pushes);
+            result.nodesGenerated += pushes.size();
+
+            // Try pushes that bring a box closer to a goal first
+            auto gain = [&](const PushMove& push) {
+                return (int)board.goalDistance[push.from + board.offsets[push.dir]] - (int)board.goalDistance[push.from];
+            };
+            std::sort(pushes.begin(), pushes.end(), [&](const PushMove& a, const PushMove& b) { return gain(a) < gain(b); });
+
+            for (const PushMove& push : pushes) {
+                uint32_t to = push.from + board.offsets[push.dir];
+                std::vector<uint32_t>& child = depthBoxes[depth + 1];
+                uint32_t childPlayer = ApplyPush(boxes.data(), push, child.data());
+                uint64_t childHash = boxHash ^ board.boxKeys[push.from] ^ board.boxKeys[to];
+                uint32_t childH = h - board.goalDistance[push.from] + board.goalDistance[to];
+
+                solution.push_back(push);
+                if (self(self, depth + 1, childPlayer, childHash, g + 1, childH)) return true;
+                solution.pop_back();
+                if (limitReached) return false;
+            }
+            return false;
+        };
+
+        while (true) {
+            iteration++;
+            nextThreshold = UNREACHABLE;
+            solution.clear();
+            if (search(search, 0, startPlayer, startHash, 0, startH)) return SolveStatus::Solved;
+            if (limitReached) return SolveStatus::LimitReached;
+            if (nextThreshold == UNREACHABLE) return SolveStatus::Unsolvable;
+            threshold = nextThreshold;
+        }
+    }
+
+    // Walks the player from push to push, turning the push list into single steps
+    void BuildMoves(const std::vector<uint32_t>& startBoxes, uint32_t startPlayer, const std::vector<PushMove>& solution) {
+        for (uint32_t cell : startBoxes) boxAt[cell] = 0;
+        uint32_t player = startPlayer;
+
+        for (const PushMove& push : solution) {
+            uint32_t target = push.from - board.offsets[push.dir];
+            size_t first = result.moves.size();
+
+            NextVisitStamp();
+            queue.clear();
+            queue.push_back(player);
+            visited[player] = visitStamp;
+            for (size_t head = 0; head < queue.size() && visited[target] != visitStamp; ++head) {
+                uint32_t cell = queue[head];
+                for (int d = 0; d < 4; ++d) {
+                    uint32_t next = cell + board.offsets[d];
+                    if (visited[next] == visitStamp || IsBlocked(next)) continue;
+                    visited[next] = visitStamp;
+                    parentDir[next] = static_cast<uint8_t>(d);
+                    queue.push_back(next);
+                }
+            }
+
+            for (uint32_t cell = target; cell != player; cell -= board.offsets[parentDir[cell]]) {
+                result.moves.push_back(Direction(parentDir[cell]));
+            }
+            std::reverse(result.moves.begin() + first, result.moves.end());
+            result.moves.push_back(Direction(push.dir));
+
+            boxAt[push.from] = NO_BOX;
+            boxAt[push.from + board.offsets[push.dir]] = 0;
+            player = push.from;
+        }
+
+        std::fill(boxAt.begin(), boxAt.end(), NO_BOX);
+        result.pushCount = static_cast<uint32_t>(solution.size());
+    }
+};
+
+// Visited state hashes, split into shards that each have their own lock and open addressing
+// table so workers only contend when they land on the same shard. Only the 64 bit Zobrist
+// key is stored, a collision would merge two states and is vanishingly rare at these sizes.
+class ShardedStateSet {
+public:
+    // Returns true when the key had not been seen before
+    bool Insert(uint64_t key) {
+        if (key == 0) key = 1;
+        Shard& shard = shards[key >> (64 - SHARD_BITS)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        size_t mask = shard.keys.size() - 1;
+        size_t i = key & mask;
+        while (shard.keys[i] != 0) {
+            if (shard.keys[i] == key) return false;
+            i = (i + 1) & mask;
+        }
+        shard.keys[i] = key;
+        if (++shard.count * 2 >= shard.keys.size()) Grow(shard);
+        return true;
+    }
+
+private:
+    static constexpr int SHARD_BITS = 6;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<uint64_t> keys = std::vector<uint64_t>(1 << 12, 0);
+        size_t count = 0;
+    };
+
+    std::array<Shard, 1 << SHARD_BITS> shards;
+
+    static void Grow(Shard& shard) {
+        std::vector<uint64_t> old = std::move(shard.keys);
+        shard.keys.assign(old.size() * 2, 0);
+        size_t mask = shard.keys.size() - 1;
+        for (uint64_t key : old) {
+            if (key == 0) continue;
+            size_t i = key & mask;
+            while (shard.keys[i] != 0) i = (i + 1) & mask;
+            shard.keys[i] = key;
+        }
+    }
+};
+
+// Visits every reachable state with one worker per thread. Each worker pops
+// its own newest states, and once it runs dry it steals the oldest half of another worker's
+// queue, which tend to root the largest unexplored subtrees.
+class ParallelExplorer {
+public:
+    ParallelExplorer(const Board& board, size_t boxCount, const ExploreOptions& options, int threadCount,
+        bool hasGoals, bool pruneDeadlocks)
+        : board(board), boxCount(boxCount), stride(boxCount + 3), options(options),
+        hasGoals(hasGoals), pruneDeadlocks(pruneDeadlocks), queues(threadCount) {}
+
+    void Run(const std::vector<uint32_t>& startBoxes, uint32_t startPlayer, ExploreResult& result) {
+        PushGenerator generator(board, boxCount, pruneDeadlocks);
+        generator.PlaceBoxes(startBoxes.data());
+        uint32_t player = generator.Reach(startPlayer);
+        generator.LiftBoxes(startBoxes.data());
+
+        uint64_t boxHash = 0;
+        for (uint32_t cell : startBoxes) boxHash ^= board.boxKeys[cell];
+
+        visited.Insert(boxHash ^ board.playerKeys[player]);
+        statesVisited = 1;
+        pending = 1;
+        PushState(0, startBoxes.data(), player, boxHash);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < queues.size(); ++i) threads.emplace_back(&ParallelExplorer::Work, this, i);
+        Work(0);
+        for (std::thread& thread : threads) thread.join();
+
+        result.statesVisited = statesVisited;
+        result.solvedStates = solvedStates;
+        result.steals = steals;
+        result.threadCount = static_cast<int>(queues.size());
+        if (solutionFound) result.status = SolveStatus::Solved;
+        else if (limitReached) result.status = SolveStatus::LimitReached;
+        else result.status = SolveStatus::Unsolvable;
+    }
+
+private:
+    // Each queued state is stride words: player, box hash low and high, then the boxes
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<uint32_t> words;
+    };
+
+    const Board& board;
+    size_t boxCount;
+    size_t stride;
+    const ExploreOptions& options;
+    bool hasGoals;
+    bool pruneDeadlocks;
+
+    std::vector<WorkQueue> queues;
+    ShardedStateSet visited;
+
+    std::atomic<size_t> pending = 0;
+    std::atomic<size_t> statesVisited = 0;
+    std::atomic<size_t> solvedStates = 0;
+    std::atomic<size_t> steals = 0;
+    std::atomic<bool> stop = false;
+    std::atomic<bool> solutionFound = false;
+    std::atomic<bool> limitReached = false;
+
+    void PushState(size_t self, const uint32_t* boxes, uint32_t player, uint64_t boxHash) {
+        WorkQueue& queue = queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.words.push_back(player);
+        queue.words.push_back(static_cast<uint32_t>(boxHash));
+        queue.words.push_back(static_cast<uint32_t>(boxHash >> 32));
+        queue.words.insert(queue.words.end(), boxes, boxes + boxCount);
+    }
+
+    bool PopState(size_t self, std::vector<uint32_t>& item) {
+        WorkQueue& queue = queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.words.size() < stride) return false;
+        auto first = queue.words.end() - stride;
+        std::copy(first, queue.words.end(), item.begin());
+        queue.words.erase(first, queue.words.end());
+        return true;
+    }
+
+    bool StealStates(size_t self) {
+        std::vector<uint32_t> batch;
+        for (size_t i = 1; i < queues.size() && batch.empty(); ++i) {
+            WorkQueue& victim = queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            size_t count = victim.words.size() / stride;
+            if (count == 0) continue;
+
+            auto last = victim.words.begin() + ((count + 1) / 2) * stride;
+            batch.assign(victim.words.begin(), last);
+            victim.words.erase(victim.words.begin(), last);
+        }
+        if (batch.empty()) return false;
+
+        steals++;
+        WorkQueue& queue = queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.words.insert(queue.words.begin(), batch.begin(), batch.end());
+        return true;
+    }
+
+    void Work(size_t self) {
+        PushGenerator generator(board, boxCount, pruneDeadlocks);
+        std::vector<uint32_t> item(stride);
+        std::vector<uint32_t> child(boxCount);
+        std::vector<PushMove> pushes;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (!PopState(self, item) && !(StealStates(self) && PopState(self, item))) {
+                if (pending.load(std::memory_order_acquire) == 0) break;
+                std::this_thread::yield();
+                continue;
+            }
+
+            uint32_t player = item[0];
+            uint64_t boxHash = item[1] | (static_cast<uint64_t>(item[2]) << 32);
+            const uint32_t* boxes = item.data() + 3;
+
+            if (hasGoals && std::all_of(boxes, boxes + boxCount, [&](uint32_t cell) { return board.goals[cell] != 0; })) {
+                solvedStates++;
+                if (options.stopAtSolution) {
+                    solutionFound = true;
+                    stop = true;
+                }
+            }
+
+            generator.GeneratePushes(boxes, player, pushes);
+            for (const PushMove& push : pushes) {
+                uint32_t to = push.from + board.offsets[push.dir];
+                uint32_t childPlayer = generator.ApplyPush(boxes, push, child.data());
+                uint64_t childHash = boxHash ^ board.boxKeys[push.from] ^ board.boxKeys[to];
+                if (!visited.Insert(childHash ^ board.playerKeys[childPlayer])) continue;
+
+                if (++statesVisited > options.maxStates) {
+                    limitReached = true;
+                    stop = true;
+                    break;
+                }
+                pending.fetch_add(1, std::memory_order_relaxed);
+                PushState(self, child.data(), childPlayer, childHash);
+            }
+
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+};
+
+}
+
+SolveResult Solve(const GameState& state, const SolverOptions& options) {
+    SolveResult result;
+    Board board;
+    std::vector<uint32_t> boxes;
+    uint32_t player = 0;
+
+    bool clipped = false;
+    result.status = BuildBoard(state, options.searchMargin, true, board, boxes, player, clipped);
+    if (result.status != SolveStatus::Solved) return result;
+
+    Search search(board, boxes.size(), options, result);
+    search.Run(boxes, player);
+    if (clipped && result.status == SolveStatus::Unsolvable) result.status = SolveStatus::LimitReached;
+    return result;
+}
+
+ExploreResult ExploreReachable(const GameState& state, const ExploreOptions& options) {
+    ExploreResult result;
+    Board board;
+    std::vector<uint32_t> boxes;
+    uint32_t player = 0;
+
+    bool clipped = false;
+    result.status = BuildBoard(state, options.searchMargin, false, board, boxes, player, clipped);
+    if (result.status != SolveStatus::Solved) return result;
+
+    int threadCount = options.threadCount > 0
+        ? options.threadCount
+        : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    // Without goals no state counts as solved, and every push would look dead since dead
+    // squares are measured against goals
+    bool hasGoals = !state.goals.Empty();
+    bool pruneDeadlocks = options.pruneDeadlocks && hasGoals;
+
+    ParallelExplorer explorer(board, boxes.size(), options, threadCount, hasGoals, pruneDeadlocks);
+    explorer.Run(boxes, player, result);
+    if (clipped && result.status == SolveStatus::Unsolvable) result.status = SolveStatus::LimitReached;
+    return result;
+}
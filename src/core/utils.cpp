@@ -0,0 +1,72 @@
+#include <utils.h>
+
+#include <algorithm>
+
+const Int2 Int2::zero(0, 0);
+const Int2 Int2::one(1, 1);
+const Int2 Int2::up(0, -1);
+const Int2 Int2::down(0, 1);
+const Int2 Int2::left(-1, 0);
+const Int2 Int2::right(1, 0);
+const Int2 Int2::min(std::numeric_limits<int>::min(), std::numeric_limits<int>::min());
+const Int2 Int2::max(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+
+const Vec2 Vec2::zero(0, 0);
+const Vec2 Vec2::one(1, 1);
+const Vec2 Vec2::up(0, -1);
+const Vec2 Vec2::down(0, 1);
+const Vec2 Vec2::left(-1, 0);
+const Vec2 Vec2::right(1, 0);
+const Vec2 Vec2::min(std::numeric_limits<float>::min(), std::numeric_limits<float>::min());
+const Vec2 Vec2::max(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+
+Arena::Arena(size_t blockSize) : nextBlockSize(blockSize > 0 ? blockSize : 1) {}
+
+Arena::~Arena() {
+    while (current != nullptr) {
+        Block* next = current->next;
+        ::operator delete(current);
+        current = next;
+    }
+}
+
+void Arena::PushBlock(size_t capacity) {
+    Block* block = static_cast<Block*>(::operator new(sizeof(Block) + capacity));
+    block->next = current;
+    block->capacity = capacity;
+    current = block;
+    cursor = reinterpret_cast<uintptr_t>(block->data());
+    limit = cursor + capacity;
+    stats.capacity += capacity;
+    stats.blockCount++;
+}
+
+void* Arena::allocSlow(size_t size, size_t align) {
+    // Whatever is left of the full block is wasted, count it so the next clear sizes its
+    // single block to fit everything this frame asked for
+    if (current != nullptr) stats.bytesUsed += limit - cursor;
+    PushBlock(std::max(nextBlockSize, size + align));
+    nextBlockSize = std::max(nextBlockSize, current->capacity) * 2;
+    return allocBytes(size, align);
+}
+
+void Arena::clear() noexcept {
+    if (current != nullptr && current->next != nullptr) {
+        size_t highWater = stats.capacity;
+        while (current != nullptr) {
+            Block* next = current->next;
+            ::operator delete(current);
+            current = next;
+        }
+        stats.capacity = 0;
+        stats.blockCount = 0;
+        // Out of memory here just leaves the arena empty, the next allocation tries again
+        try { PushBlock(highWater); }
+        catch (const std::bad_alloc&) { cursor = limit = 0; }
+        nextBlockSize = highWater * 2;
+    }
+    else if (current != nullptr) {
+        cursor = reinterpret_cast<uintptr_t>(current->data());
+    }
+    stats.bytesUsed = 0;
+}
@@ -3,6 +3,10 @@
 #include <tilemap.h>
 #include <gameObjects.h>
 #include <levels.h>
+#include <solver.h>
+#include <moveHistory.h>
+#include <replay.h>
+#include <assetLoader.h>
 #include <ui.h>
 #include <format>
 #include <glad.h>
@@ -16,6 +20,9 @@
 #include <input.h>
 #include <glm/ext.hpp>
 #include <array>
+#include <cstring>
+#include <unordered_map>
+#include <memory>
 
 Int2 screenSize = Int2(1920, 1080);
 glm::mat4 projection;
@@ -25,18 +32,43 @@ float dt = 0.0f;
 constexpr float moveDuration = 0.25f;
 constexpr float targetFrameTime = 1.0f / 165.0f;
 
+// Game logic runs in fixed steps, independent of the frame rate
+constexpr float simulationStep = 1.0f / 240.0f;
+constexpr int maxSimulationSteps = 16;
+constexpr float maxFrameTime = simulationStep * maxSimulationSteps;
+
 Tilemap world;
-Int2 playerPos;
+MoveHistory history;
+ReplayRecorder recorder;
+// Set while a replay passed on the command line drives the game instead of the keyboard
+ReplayPlayer* playback = nullptr;
+// Levels the replay adds, loaded on first use and kept for the rest of the run
+std::unordered_map<std::string, std::unique_ptr<Level>> replayLevels;
+uint32_t simulationStepCount = 0;
+bool RunHeadlessReplay(const Replay& replay);
 void Move(Int2 movement);
+void SimulationStep(float step);
+void AnimateBoxes(float t);
 
 Int2 lastMoveDir = Int2::zero;
 
-void DrawPlayer();
+Vec2 PlayerRenderPos(float t);
+void DrawPlayer(float t);
 
 float tick_t = 0.0f;
+float prevTick_t = 0.0f;
 bool tickInProgress = false;
 
-void LevelSelect(UIContext& ui, Level* level, Int2 position, Texture image) {
+std::string solverStatus = "Solver: press F to check the drafted world";
+void CheckSolvable();
+
+void PlaceLevel(const Level& level, const char* path, Int2 position) {
+    if (!world.AddLevel(level, position)) return;
+    history.Reset(world.state);
+    recorder.RecordAddLevel(simulationStepCount, path, position);
+}
+
+void LevelSelect(UIContext& ui, Level* level, const char* path, Int2 position, Texture image) {
     ui.Panel(UI::PanelStyle{ 
             .image = image, 
             .sizing = {UI::Fixed(400), UI::Fixed(400)},
@@ -45,7 +77,7 @@ void LevelSelect(UIContext& ui, Level* level, Int2 position, Texture image) {
         }, UI::Callbacks{.label = "select",
             .onHover = [](UI::Element& e) {e.style.backgroundColor = LIGHTGRAY; },
             .onActive = [](UI::Element& e) {e.style.backgroundColor = GRAY; },
-            .onClick = [level, position](UI::Element& e) {world.AddLevel(*level, position); }
+            .onClick = [level, path, position](UI::Element& e) {PlaceLevel(*level, path, position); }
         });
 }
 
@@ -64,9 +96,25 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
 
 int fps = 0;
 
-int main(void) {
+int main(int argc, char** argv) {
     createDebugConsole();
 
+    // --replay <file> plays a recorded session back in real time, add --headless to run it
+    // to the end at full speed without opening a window and report whether it still matches
+    const char* replayFile = nullptr;
+    bool headless = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayFile = argv[++i];
+        else if (std::strcmp(argv[i], "--headless") == 0) headless = true;
+    }
+
+    Replay replay;
+    if (replayFile != nullptr && !LoadReplay(replayFile, replay)) {
+        debugError("Failed to load replay \"%s\"\n", replayFile);
+        return -1;
+    }
+    if (replayFile != nullptr && headless) return RunHeadlessReplay(replay) ? 0 : 1;
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -99,24 +147,26 @@ int main(void) {
     InitializeInput(window);
     InitTextRenderer(screenDPI);
 
-    playerPos = { 0, 0 };
-
     //Camera2D cam = { 0 };
     //cam.offset = VEC2_ZERO;
     //cam.rotation = 0.0f;
 
     UIContext ui = UIContext();
 
-    const char* tilemapFile = "res/tilemap.tmx";
+    // Everything but the world itself streams in on worker threads while the first frames run
+    AssetLoader assets;
+    const char* testLevelFile = "res/testLevel.tmx";
+    AssetHandle<Level> testLevel = assets.LoadLevel(testLevelFile);
+    AssetHandle<Texture> testLevelImg = assets.LoadTexture("res/testlevel.png");
+    AssetHandle<Font> font = assets.LoadFont("res/fonts/Merriweather_24pt-Regular.ttf");
+
+    const char* tilemapFile = replayFile != nullptr ? replay.baseMap.c_str() : "res/tilemap.tmx";
     world = Tilemap();
     world.LoadTilemap(tilemapFile, &shader);
-    std::vector<Level> levels;
-    Level* testLevel = LoadLevel("res/testLevel.tmx");
-    if (testLevel != nullptr) levels.push_back(*testLevel);
-
-    Texture testLevelImg = LoadTexture("res/testlevel.png");
-
-    Font* font = LoadFont("res/fonts/Merriweather_24pt-Regular.ttf");
+    world.state.playerPos = replayFile != nullptr ? replay.playerStart : Int2::zero;
+    history.Reset(world.state);
+    recorder.Begin(tilemapFile, world.state.playerPos);
+    if (replayFile != nullptr) playback = new ReplayPlayer(std::move(replay));
 
     bool levelPickUIOpen = false;
 
@@ -124,6 +174,8 @@ int main(void) {
 
     std::array<int, 120> fpsNums;
     int totalFrameCount = 0;
+    FrameStats lastFrameStats;
+    float accumulator = 0.0f;
 
     while (!glfwWindowShouldClose(window)) {
         float currentFrameTime = static_cast<float>(glfwGetTime());
@@ -139,51 +191,40 @@ int main(void) {
             std::this_thread::sleep_for(std::chrono::duration<float>(targetFrameTime - dt));
         }
         lastFrameTime = currentFrameTime;
+        ResetFrameStats();
+        assets.Update();
 
         UpdateInputState();
         Vec2 mousePos = GetMousePos();
 
-        if (!tickInProgress) {
-            if (GetKeyState(KEY_W).down || GetKeyState(KEY_UP).down) Move(Int2::up);
-            if (GetKeyState(KEY_S).down || GetKeyState(KEY_DOWN).down) Move(Int2::down);
-            if (GetKeyState(KEY_A).down || GetKeyState(KEY_LEFT).down) Move(Int2::left);
-            if (GetKeyState(KEY_D).down || GetKeyState(KEY_RIGHT).down) Move(Int2::right);
+        // Only the replay places levels while it plays
+        if (playback == nullptr && GetKeyState(KEY_SPACE).released) levelPickUIOpen = !levelPickUIOpen;
+        if (GetKeyState(KEY_F).released) CheckSolvable();
+        if (playback == nullptr && !tickInProgress) {
+            if (GetKeyState(KEY_Z).pressed && history.Undo(world.state)) recorder.RecordUndo(simulationStepCount);
+            if (GetKeyState(KEY_Y).pressed && history.Redo(world.state)) recorder.RecordRedo(simulationStepCount);
+        }
+        if (GetKeyState(KEY_R).released) {
+            if (SaveReplay(recorder.Finish(world.state), "replay.skr")) debugLog("Saved replay.skr\n");
+            else debugError("Failed to save replay.skr\n");
         }
 
-        if (GetKeyState(KEY_SPACE).released) levelPickUIOpen = !levelPickUIOpen;
-
-        if (tickInProgress) {
-            tick_t += dt / moveDuration;
-
-            std::vector<Int2> toUpdate;
-            toUpdate.reserve(world.gameObjects.boxes.size());
-
-            for (auto& pair : world.gameObjects.boxes) {
-                if (pair.second.pushData.isMoving) toUpdate.push_back(pair.first);
-            }
-            std::sort(toUpdate.begin(), toUpdate.end(), [](Int2 a, Int2 b) {
-                if (world.gameObjects.boxes[a].pushData.moveDelta == Int2::up) {
-                    return a.y < b.y;
-                } else if (world.gameObjects.boxes[a].pushData.moveDelta == Int2::down) {
-                    return a.y > b.y;
-                } else if (world.gameObjects.boxes[a].pushData.moveDelta == Int2::left) {
-                    return a.x < b.x;
-                } else if (world.gameObjects.boxes[a].pushData.moveDelta == Int2::right) {
-                    return a.x > b.x;
-                }
-            });
-            for (auto& pos : toUpdate) {
-                UpdatePushable(world, world.gameObjects.boxes[pos].pushData, world.objects[pos], tick_t);
-            }
-
-            if (tick_t >= 1.0f) {
-                tick_t = 0.0f;
-                tickInProgress = false;
-                playerPos += lastMoveDir;
-            }
+        accumulator += std::min(dt, maxFrameTime);
+        while (accumulator >= simulationStep) {
+            prevTick_t = tick_t;
+            SimulationStep(simulationStep);
+            accumulator -= simulationStep;
         }
 
-        Vec2 target = world.TilemapToWorldPos(playerPos) + (Vec2)lastMoveDir * (Smoothstep(tick_t) * world.tileSize.x) + (Vec2)world.tileSize * 0.5f;
+        // Render between the last two simulation states. A move that finished this step
+        // resets tick_t, so there is nothing to blend from.
+        float alpha = accumulator / simulationStep;
+        float renderTick_t = tickInProgress && tick_t >= prevTick_t
+            ? prevTick_t + (tick_t - prevTick_t) * alpha
+            : tick_t;
+        AnimateBoxes(renderTick_t);
+
+        Vec2 target = PlayerRenderPos(renderTick_t) + (Vec2)world.tileSize * 0.5f;
         camPos = (Vec2)screenSize * 0.5f - Vec2(target.x, target.y) * zoom;
 
         UI::MouseState currMouseState = UI::MouseState{
@@ -194,27 +235,60 @@ int main(void) {
         };
         ui.BeginUI(screenSize, currMouseState); {
             using namespace UI;
-            if (levelPickUIOpen) {
+            if (levelPickUIOpen && testLevel.Ready() && testLevelImg.Ready()) {
                 ui.Panel(PanelStyle{
                         .alignX = AlignX::CENTER,
                         .alignY = AlignY::CENTER,
                         .backgroundColor = BLANK,
                     }, [&] {
-                          LevelSelect(ui, testLevel, {8, 8}, testLevelImg);
+                          LevelSelect(ui, testLevel.Get(), testLevelFile, {16, 0}, *testLevelImg.Get());
+                    });
+            }
+            // The overlay appears once its font has finished loading
+            Font* uiFont = font.Get();
+            if (uiFont != nullptr) {
+                ui.Text(std::format("FPS: {}", fps), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 0}),
+                    });
+                ui.Text(std::format("Player position: ({}, {})", world.state.playerPos.x, world.state.playerPos.y), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 40}),
+                    });
+                ui.Text(std::format("Mouse position: ({}, {})", mousePos.x, mousePos.y), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 80}),
+                    });
+                ui.Text(std::format("Uploaded: {} bytes", lastFrameStats.bytesUploaded), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 120}),
+                    });
+                ui.Text(std::format("Chunks: {} drawn, {} culled", lastFrameStats.chunksDrawn, lastFrameStats.chunksCulled), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 160}),
+                    });
+                ui.Text(std::format("Objects: {} drawn, {} culled", lastFrameStats.objectsDrawn, lastFrameStats.objectsCulled), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 200}),
+                    });
+                ui.Text(std::format("Tile buffer: {} KB peak", world.GetPeakInstanceBufferSize() / 1024), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 240}),
+                    });
+                ui.Text(std::format("Draw calls: {} ({} batched quads)", lastFrameStats.drawCalls, lastFrameStats.quadsBatched), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 280}),
+                    });
+                ui.Text(solverStatus, {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 320}),
+                    });
+                ui.Text(std::format("UI layout: {} of {} nodes, arena {} KB in {} blocks", ui.relayoutCount, ui.elementCount,
+                    ui.GetArenaStats().peakBytes / 1024, ui.GetArenaStats().blockCount), {
+                    .font = uiFont,
+                    .positioning = Absolute({0, 360}),
                     });
             }
-            ui.Text(std::format("FPS: {}", fps), {
-                .font = font,
-                .positioning = Absolute({0, 0}),
-                });
-            ui.Text(std::format("Player position: ({}, {})", playerPos.x, playerPos.y), {
-                .font = font,
-                .positioning = Absolute({0, 40}),
-                });
-            ui.Text(std::format("Mouse position: ({}, {})", mousePos.x, mousePos.y), {
-                .font = font,
-                .positioning = Absolute({0, 80}),
-                });
         } ui.EndUI();
 
         ClearColor(SKYBLUE);
@@ -224,11 +298,14 @@ int main(void) {
         projection = glm::scale(projection, glm::vec3(zoom, zoom, 1.0f));
 
         world.Render(0);
-        DrawPlayer();
+        DrawPlayer(renderTick_t);
 
         projection = glm::ortho(0.0f, (float)screenSize.x, (float)screenSize.y, 0.0f, -1.0f, 1.0f);
 
         ui.Render();
+        FlushRenderer();
+
+        lastFrameStats = frameStats;
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -238,37 +315,118 @@ int main(void) {
     return 0;
 }
 
+void CheckSolvable() {
+    auto start = std::chrono::steady_clock::now();
+    SolveResult result = Solve(world.state);
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    switch (result.status) {
+    case SolveStatus::Solved:
+        solverStatus = std::format("Solver: solvable in {} pushes, {} moves ({} nodes, {:.1f} ms)",
+            result.pushCount, result.moves.size(), result.nodesExpanded, ms);
+        break;
+    case SolveStatus::Unsolvable:
+        solverStatus = std::format("Solver: unsolvable ({} nodes, {:.1f} ms)", result.nodesExpanded, ms);
+        break;
+    case SolveStatus::LimitReached:
+        solverStatus = std::format("Solver: gave up after {} nodes ({:.1f} ms)", result.nodesExpanded, ms);
+        break;
+    case SolveStatus::InvalidBoard:
+        solverStatus = "Solver: needs at least as many goals as boxes";
+        break;
+    }
+}
+
 void Move(Int2 movement) {
-    Int2 targetPos = playerPos + movement;
+    MoveResult result = world.state.Move(movement);
+    recorder.RecordMove(simulationStepCount, movement, result.moved);
+    if (!result.moved) return;
+    history.Record(world.state, result);
 
-    if (world.IsSolid(targetPos)) return;
-    if (world.gameObjects.boxes.count(targetPos) > 0) {
-        std::vector<Int2> boxesToPushKeys;
-        boxesToPushKeys.push_back(targetPos);
-        Int2 currPos = targetPos;
+    tickInProgress = true;
+    tick_t = 0.0f;
+    lastMoveDir = movement;
+}
 
-        while (world.gameObjects.boxes.count(currPos + movement) > 0) {
-            boxesToPushKeys.push_back(currPos + movement);
-            currPos += movement;
-        }
+void ApplyReplayEvent(const ReplayEvent& event) {
+    switch (event.type) {
+    case ReplayEventType::Move:
+        Move(event.direction);
+        break;
+    case ReplayEventType::AddLevel: {
+        const std::string& path = playback->GetReplay().levelPaths[event.level];
+        std::unique_ptr<Level>& level = replayLevels[path];
+        if (level == nullptr) level.reset(LoadLevel(path.c_str()));
+        if (level != nullptr) PlaceLevel(*level, path.c_str(), event.position);
+        break;
+    }
+    case ReplayEventType::Undo:
+        if (history.Undo(world.state)) recorder.RecordUndo(simulationStepCount);
+        break;
+    case ReplayEventType::Redo:
+        if (history.Redo(world.state)) recorder.RecordRedo(simulationStepCount);
+        break;
+    }
+}
 
-        if (world.IsSolid(currPos + movement)) return;
+bool RunHeadlessReplay(const Replay& replay) {
+    ReplayRunner runner;
+    PlaybackResult result;
+    auto start = std::chrono::steady_clock::now();
+    if (!runner.Run(replay, result)) {
+        debugError("Replay references a level that failed to load\n");
+        return false;
+    }
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-        for (auto it = boxesToPushKeys.rbegin(); it != boxesToPushKeys.rend(); ++it) {
-            Push(world.gameObjects.boxes[*it].pushData, movement);
-        }
+    debugLog("Replayed %zu events in %.2f ms: %zu moves applied, %zu refused\n",
+        result.eventsApplied, ms, result.movesApplied, result.movesRefused);
+    if (result.divergences > 0) {
+        debugLog("%zu moves diverged from the recording, first at event %zu\n", result.divergences, result.firstDivergence);
     }
+    debugLog("Final state checksum %016llx (%s)\n", (unsigned long long)result.checksum,
+        result.checksumMatches ? "matches" : "MISMATCH");
+    return result.divergences == 0 && result.checksumMatches;
+}
 
-    tickInProgress = true;
-    tick_t = 0.0f;
-    lastMoveDir = movement;
+void SimulationStep(float step) {
+    if (playback != nullptr) {
+        ReplayEvent event;
+        while (playback->Next(simulationStepCount, event)) ApplyReplayEvent(event);
+    }
+    else if (!tickInProgress) {
+        if (GetKeyState(KEY_W).down || GetKeyState(KEY_UP).down) Move(Int2::up);
+        else if (GetKeyState(KEY_S).down || GetKeyState(KEY_DOWN).down) Move(Int2::down);
+        else if (GetKeyState(KEY_A).down || GetKeyState(KEY_LEFT).down) Move(Int2::left);
+        else if (GetKeyState(KEY_D).down || GetKeyState(KEY_RIGHT).down) Move(Int2::right);
+    }
+    simulationStepCount++;
+
+    if (!tickInProgress) return;
+
+    tick_t = fminf(tick_t + step / moveDuration, 1.0f);
+
+    UpdatePushables(world.state.gameObjects.boxes, tick_t);
+
+    if (tick_t >= 1.0f) {
+        tick_t = 0.0f;
+        tickInProgress = false;
+    }
 }
 
-void DrawPlayer() {
-    Vec2 worldPos = world.TilemapToWorldPos(playerPos);
+void AnimateBoxes(float t) {
+    AnimatePushables(world.state.gameObjects.boxes, t);
+}
+
+// The game state has already moved the player, slide the drawn position in from the previous cell
+Vec2 PlayerRenderPos(float t) {
+    Vec2 worldPos = world.TilemapToWorldPos(world.state.playerPos);
     if (tickInProgress) {
-        Vec2 offset = (Vec2)lastMoveDir * (Smoothstep(tick_t) * (float)world.tileSize.x);
-        worldPos = worldPos + offset;
+        worldPos -= (Vec2)lastMoveDir * ((1.0f - Smoothstep(t)) * (float)world.tileSize.x);
     }
-    DrawRect(worldPos, (Vec2)world.tileSize, YELLOW, 16.0f);
+    return worldPos;
+}
+
+void DrawPlayer(float t) {
+    DrawRect(PlayerRenderPos(t), (Vec2)world.tileSize, YELLOW, 16.0f);
 }
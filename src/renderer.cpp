@@ -5,12 +5,41 @@
 #include <shader.h>
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
+#include <algorithm>
+#include <vector>
 
 unsigned int rectVAO = 0;
 unsigned int rectVBO = 0;
 unsigned int rectEBO = 0;
 
 Shader rectShader;
+UniformHandle rectProjection;
+UniformHandle rectTexture;
+
+struct QuadInstance {
+    glm::vec4 rect;
+    glm::vec4 uvRec;
+    glm::vec4 color;
+    glm::vec4 borderColor;
+    glm::vec3 params; // radius, border width, QuadMode
+};
+
+enum QuadMode {
+    QUAD_RECT = 0,
+    QUAD_TEXTURED = 1,
+    QUAD_GLYPH = 2,
+};
+
+constexpr size_t INITIAL_BATCH_QUADS = 1024;
+
+// Quads queued since the last flush. Untextured quads can join any batch, so a batch only
+// breaks when a textured quad needs a different texture or the projection changes.
+std::vector<QuadInstance> quadBatch;
+unsigned int batchTexture = 0;
+glm::mat4 batchProjection;
+GrowableBuffer quadBuffer;
+
+FrameStats frameStats;
 
 extern Int2 screenSize;
 
@@ -49,9 +78,25 @@ void InitRenderer() {
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
+    quadBuffer.Create(INITIAL_BATCH_QUADS * sizeof(QuadInstance));
+
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, rect));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, uvRec));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, color));
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, borderColor));
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, params));
+    for (unsigned int i = 1; i <= 5; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+
     glBindVertexArray(0);
 
+    quadBatch.reserve(INITIAL_BATCH_QUADS);
+
     rectShader = Shader("rect.vert", "rect.frag");
+    rectProjection = rectShader.getUniform("projection");
+    rectTexture = rectShader.getUniform("texture0");
 }
 
 void ClearColor(Color color) {
@@ -59,67 +104,178 @@ void ClearColor(Color color) {
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
-Texture LoadTexture(const char* path) {
+void GrowableBuffer::Create(size_t initialCapacity, GLenum bufferTarget, GLenum bufferUsage) {
+    target = bufferTarget;
+    usage = bufferUsage;
+    capacity = initialCapacity;
+    peakCapacity = initialCapacity;
+
+    glGenBuffers(1, &id);
+    glBindBuffer(target, id);
+    glBufferData(target, capacity, nullptr, usage);
+}
+
+void GrowableBuffer::Reserve(size_t bytes, bool preserveContents) {
+    glBindBuffer(target, id);
+    if (bytes <= capacity) return;
+
+    size_t newCapacity = capacity > 0 ? capacity : bytes;
+    while (newCapacity < bytes) newCapacity *= 2;
+
+    if (!preserveContents) {
+        // Orphan the old storage so the driver never stalls on draws still reading it
+        glBufferData(target, newCapacity, nullptr, usage);
+    } else {
+        unsigned int newID;
+        glGenBuffers(1, &newID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newID);
+        glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, usage);
+        glBindBuffer(GL_COPY_READ_BUFFER, id);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity);
+        glDeleteBuffers(1, &id);
+
+        id = newID;
+        glBindBuffer(target, id);
+    }
+
+    capacity = newCapacity;
+    peakCapacity = std::max(peakCapacity, capacity);
+}
+
+void GrowableBuffer::Upload(size_t offset, const void* data, size_t bytes) {
+    Reserve(offset + bytes, true);
+    glBufferSubData(target, offset, bytes, data);
+    frameStats.bytesUploaded += bytes;
+}
+
+void GrowableBuffer::Stream(const void* data, size_t bytes) {
+    if (bytes > capacity) {
+        Reserve(bytes, false);
+    } else {
+        glBindBuffer(target, id);
+        glBufferData(target, capacity, nullptr, usage);
+    }
+    glBufferSubData(target, 0, bytes, data);
+    frameStats.bytesUploaded += bytes;
+}
+
+void ResetFrameStats() {
+    frameStats = FrameStats{};
+}
+
+// World-space bounds of the screen under the current projection
+Rect GetVisibleRect() {
+    glm::mat4 inverse = glm::inverse(projection);
+    glm::vec4 a = inverse * glm::vec4(-1.0f, -1.0f, 0.0f, 1.0f);
+    glm::vec4 b = inverse * glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+
+    Vec2 minCorner = Vec2(fminf(a.x, b.x), fminf(a.y, b.y));
+    Vec2 maxCorner = Vec2(fmaxf(a.x, b.x), fmaxf(a.y, b.y));
+    return Rect(minCorner, maxCorner - minCorner);
+}
+
+bool DecodeImage(const char* path, ImageData& image) {
+    unsigned char* data = stbi_load(path, &image.width, &image.height, &image.channels, 0);
+    if (data == NULL) {
+        debugError("Failed to load texture from \"%s\"\n", path);
+        return false;
+    }
+
+    image.pixels.assign(data, data + (size_t)image.width * image.height * image.channels);
+    stbi_image_free(data);
+    return true;
+}
+
+Texture UploadTexture(const ImageData& image) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
     GLenum format = GL_INVALID_ENUM;
-    if (data != NULL) {
-        switch (nrChannels) {
+    if (!image.pixels.empty()) {
+        switch (image.channels) {
             case 1: format = GL_RED; break;
             case 3: format = GL_RGB; break;
             case 4: format = GL_RGBA; break;
-            default: debugError("Invalid number of channels: %d\n", nrChannels); break;
+            default: debugError("Invalid number of channels: %d\n", image.channels); break;
         }
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    } else {
-        debugError("Failed to load texture from \"%s\"\n", path);
     }
-    stbi_image_free(data);
 
-    return Texture{ textureID, width, height, format };
+    return Texture{ textureID, image.width, image.height, format };
 }
 
-void DrawRect(Vec2 position, Vec2 size, Color backgroundColor, 
-    float roundRadius, float borderWidth, Color borderColor) {
-    rectShader.use();
+Texture LoadTexture(const char* path) {
+    ImageData image;
+    DecodeImage(path, image);
+    return UploadTexture(image);
+}
 
-    rectShader.setVec4("rect", glm::vec4(position.x, position.y, size.x, size.y));
-    rectShader.setFloat("radius", roundRadius);
-    rectShader.setFloat("border", borderWidth);
-    rectShader.setVec4("bgColor", vColor(backgroundColor));
-    rectShader.setVec4("borderColor", vColor(borderColor));
-    rectShader.setMat4("projection", projection);
-    rectShader.setBool("useTexture", false);
+static void QueueQuad(const QuadInstance& quad, unsigned int texture) {
+    bool textureChanged = texture != 0 && batchTexture != 0 && texture != batchTexture;
+    if (!quadBatch.empty() && (textureChanged || projection != batchProjection)) FlushRenderer();
 
-    glBindVertexArray(rectVAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    if (quadBatch.empty()) batchProjection = projection;
+    if (texture != 0) batchTexture = texture;
+    quadBatch.push_back(quad);
 }
 
-void DrawTexturedRect(Vec2 position, Vec2 size, Texture texture, Vec2 baseUV, Vec2 uvOffset, Color tint) {
+void FlushRenderer() {
+    if (quadBatch.empty()) return;
+
     rectShader.use();
-    rectShader.setVec4("rect", glm::vec4(position.x, position.y, size.x, size.y));
-    rectShader.setFloat("radius", 0.0f);
-    rectShader.setFloat("border", 0.0f);
-    rectShader.setVec4("bgColor", vColor(tint));
-    rectShader.setMat4("projection", projection);
-    rectShader.setBool("useTexture", true);
-    rectShader.setInt("texture0", 0);
-    rectShader.setVec4("uvRec", glm::vec4(baseUV.x, baseUV.y, uvOffset.x, uvOffset.y));
+    rectShader.setMat4(rectProjection, batchProjection);
+    rectShader.setInt(rectTexture, 0);
 
-    glBindVertexArray(rectVAO);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
     glActiveTexture(GL_TEXTURE0);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glBindTexture(GL_TEXTURE_2D, batchTexture);
+
+    glBindVertexArray(rectVAO);
+    quadBuffer.Stream(quadBatch.data(), quadBatch.size() * sizeof(QuadInstance));
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)quadBatch.size());
+    glBindVertexArray(0);
+
+    frameStats.drawCalls++;
+    frameStats.quadsBatched += static_cast<uint32_t>(quadBatch.size());
+
+    quadBatch.clear();
+    batchTexture = 0;
 }
 
+void DrawRect(Vec2 position, Vec2 size, Color backgroundColor, 
+    float roundRadius, float borderWidth, Color borderColor) {
+    QueueQuad(QuadInstance{
+        glm::vec4(position.x, position.y, size.x, size.y),
+        glm::vec4(0.0f),
+        vColor(backgroundColor),
+        vColor(borderColor),
+        glm::vec3(roundRadius, borderWidth, (float)QUAD_RECT)
+    }, 0);
+}
+
+void DrawTexturedRect(Vec2 position, Vec2 size, Texture texture, Vec2 baseUV, Vec2 uvOffset, Color tint) {
+    QueueQuad(QuadInstance{
+        glm::vec4(position.x, position.y, size.x, size.y),
+        glm::vec4(baseUV.x, baseUV.y, uvOffset.x, uvOffset.y),
+        vColor(tint),
+        glm::vec4(0.0f),
+        glm::vec3(0.0f, 0.0f, (float)QUAD_TEXTURED)
+    }, texture.id);
+}
+
+void DrawGlyph(Vec2 position, Vec2 size, Texture atlas, Vec2 baseUV, Vec2 uvOffset, Color color) {
+    QueueQuad(QuadInstance{
+        glm::vec4(position.x, position.y, size.x, size.y),
+        glm::vec4(baseUV.x, baseUV.y, uvOffset.x, uvOffset.y),
+        vColor(color),
+        glm::vec4(0.0f),
+        glm::vec3(0.0f, 0.0f, (float)QUAD_GLYPH)
+    }, atlas.id);
+}
@@ -90,6 +90,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         debugError("Shader program linking failed\n%s", infoLog);
     } else {
         debugLog("Shader program linked");
+        cacheUniformLocations();
     }
 
     glDeleteShader(vertex);
@@ -100,10 +101,40 @@ void Shader::use() {
     glUseProgram(ID);
 }
 
+void Shader::cacheUniformLocations() {
+    constexpr size_t maxNameLength = 256;
+
+    int uniformCount = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+    for (int i = 0; i < uniformCount; ++i) {
+        char name[maxNameLength];
+        int nameLength = 0;
+        int size = 0;
+        GLenum type;
+        glGetActiveUniform(ID, (unsigned int)i, maxNameLength, &nameLength, &size, &type, name);
+
+        std::string uniformName(name, nameLength);
+        int loc = glGetUniformLocation(ID, uniformName.c_str());
+
+        // Arrays are reported as "name[0]", make them reachable by their plain name too
+        size_t bracket = uniformName.find('[');
+        if (bracket != std::string::npos) uniformLocations[uniformName.substr(0, bracket)] = loc;
+        uniformLocations[uniformName] = loc;
+    }
+}
+
 int Shader::tryGetLoc(const std::string& name) const {
-    int loc = glGetUniformLocation(ID, name.c_str());
-    if (loc == -1) debugError("Failed to get uniform location for \"%s\"", name.c_str());
-    return loc;
+    auto it = uniformLocations.find(name);
+    if (it == uniformLocations.end()) {
+        debugError("Failed to get uniform location for \"%s\"", name.c_str());
+        return -1;
+    }
+    return it->second;
+}
+
+UniformHandle Shader::getUniform(const std::string& name) const {
+    return UniformHandle{ tryGetLoc(name) };
 }
 
 void Shader::setBool(const std::string& name, bool value) const {
@@ -132,3 +163,31 @@ void Shader::setVec4(const std::string& name, glm::vec4 value) const {
 void Shader::setMat4(const std::string& name, glm::mat4 value) const {
     glUniformMatrix4fv(tryGetLoc(name), 1, GL_FALSE, glm::value_ptr(value));
 }
+
+void Shader::setBool(UniformHandle uniform, bool value) const {
+    glUniform1i(uniform.location, (int)value);
+}
+
+void Shader::setInt(UniformHandle uniform, int value) const {
+    glUniform1i(uniform.location, value);
+}
+
+void Shader::setFloat(UniformHandle uniform, float value) const {
+    glUniform1f(uniform.location, value);
+}
+
+void Shader::setVec2(UniformHandle uniform, glm::vec2 value) const {
+    glUniform2f(uniform.location, value.x, value.y);
+}
+
+void Shader::setVec3(UniformHandle uniform, glm::vec3 value) const {
+    glUniform3f(uniform.location, value.x, value.y, value.z);
+}
+
+void Shader::setVec4(UniformHandle uniform, glm::vec4 value) const {
+    glUniform4f(uniform.location, value.x, value.y, value.z, value.w);
+}
+
+void Shader::setMat4(UniformHandle uniform, glm::mat4 value) const {
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
\ No newline at end of file
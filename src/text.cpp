@@ -2,59 +2,56 @@
 #include <Debug.h>
 #include <Windows.h>
 #include <cstring>
-#include <shader.h>
-#include <glm/glm.hpp>
-#include <glm/ext.hpp>
+#include <algorithm>
 #include <renderer.h>
 #include <vector>
 
-FT_Library ft;
 Int2 dpi;
-FT_Face face;
-
-unsigned int VAO, VBO;
-Shader textShader;
 
 void InitTextRenderer(Vec2 screenDPI) {
-    if (FT_Init_FreeType(&ft)) {
-        debugError("Failed to initialize FreeType\n");
-        return;
-    }
     dpi = screenDPI;
-
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    textShader = Shader("text.vert", "text.frag");
 }
 
 constexpr float baseFontSize = 48.0f;
+constexpr int atlasWidth = 512;
+constexpr int atlasPadding = 1;
+
+struct GlyphBitmap {
+    Int2 size;
+    Int2 atlasPos;
+    std::vector<unsigned char> pixels;
+};
+
+bool RasterizeFont(const char* path, FontBitmap& bitmap) {
+    // FreeType libraries must not be shared between threads, so each font gets its own
+    FT_Library ft;
+    if (FT_Init_FreeType(&ft)) {
+        debugError("Failed to initialize FreeType\n");
+        return false;
+    }
 
-Font* LoadFont(const char* path) {
+    FT_Face face;
     auto error = FT_New_Face(ft, path, 0, &face);
     if (error == FT_Err_Unknown_File_Format) {
         debugError("Font from \"%s\" is unsupported\n", path);
-        return nullptr;
+        FT_Done_FreeType(ft);
+        return false;
     } else if (error) {
         debugError("Failed to load font from \"%s\"\n", path);
-        return nullptr;
+        FT_Done_FreeType(ft);
+        return false;
     }
 
     FT_Set_Char_Size(face, 0, baseFontSize * 64, dpi.x, dpi.y);
 
-    Font* font = new Font();
+    Font* font = &bitmap.font;
+    *font = Font{};
     font->baseFontSize = baseFontSize;
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // Rasterize every glyph and shelf-pack it into rows of the atlas
+    std::array<GlyphBitmap, ASCII_END> bitmaps;
+    Int2 cursor = Int2(atlasPadding, atlasPadding);
+    int shelfHeight = 0;
 
     for (int i = ASCII_BEGIN; i < ASCII_END; ++i) {
         error = FT_Load_Char(face, (char)i, FT_LOAD_RENDER);
@@ -66,70 +63,99 @@ Font* LoadFont(const char* path) {
         auto& metrics = face->glyph->metrics;
         auto& bmp = face->glyph->bitmap;
 
-        std::vector<unsigned char> flipped(bmp.width * bmp.rows);
+        GlyphBitmap& glyph = bitmaps[i];
+        glyph.size = Int2((int)bmp.width, (int)bmp.rows);
+        glyph.pixels.resize(bmp.width * bmp.rows);
         for (unsigned int row = 0; row < bmp.rows; ++row) {
-            memcpy(&flipped[row * bmp.width],
-                bmp.buffer + (bmp.rows - 1 - row) * bmp.pitch,
-                bmp.width);
+            memcpy(&glyph.pixels[row * bmp.width], bmp.buffer + row * bmp.pitch, bmp.width);
+        }
+
+        if (cursor.x + glyph.size.x + atlasPadding > atlasWidth) {
+            cursor = Int2(atlasPadding, cursor.y + shelfHeight + atlasPadding);
+            shelfHeight = 0;
         }
+        glyph.atlasPos = cursor;
+        cursor.x += glyph.size.x + atlasPadding;
+        shelfHeight = std::max(shelfHeight, glyph.size.y);
 
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            bmp.width,
-            bmp.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            flipped.data()
-        );
-
-        Character character = {
-            texture,
+        font->characters[i] = Character{
+            Vec2::zero,
+            Vec2::zero,
             Int2(metrics.width / 64.0f, metrics.height / 64.0f),
             Int2(metrics.horiBearingX / 64.0f, metrics.horiBearingY / 64.0f),
             metrics.horiAdvance
         };
-
-        font->characters[i] = character;
         font->ascender = face->ascender / 64;
         font->descender = face->descender / 64;
         font->lineHeight = (float)face->height / 64.0f;
     }
 
-    debugLog("Loaded font %s", face->family_name);
+    int atlasHeight = 1;
+    while (atlasHeight < cursor.y + shelfHeight + atlasPadding) atlasHeight *= 2;
+
+    bitmap.atlasPixels.assign((size_t)atlasWidth * atlasHeight, 0);
+    Vec2 atlasSize = Vec2(atlasWidth, atlasHeight);
+    for (int i = ASCII_BEGIN; i < ASCII_END; ++i) {
+        const GlyphBitmap& glyph = bitmaps[i];
+        for (int row = 0; row < glyph.size.y; ++row) {
+            memcpy(&bitmap.atlasPixels[(size_t)glyph.atlasPos.x + (size_t)(glyph.atlasPos.y + row) * atlasWidth],
+                &glyph.pixels[(size_t)row * glyph.size.x],
+                glyph.size.x);
+        }
+        font->characters[i].uvOrigin = (Vec2)glyph.atlasPos / atlasSize;
+        font->characters[i].uvSize = (Vec2)glyph.size / atlasSize;
+    }
+    font->atlas = Texture{ 0, atlasWidth, atlasHeight, GL_RED };
+
+    debugLog("Loaded font %s into a %dx%d atlas", face->family_name, atlasWidth, atlasHeight);
     FT_Done_Face(face);
-    return font;
+    FT_Done_FreeType(ft);
+    return true;
 }
 
-struct Vec4 { float x, y, z, w; };
+void UploadFontAtlas(FontBitmap& bitmap) {
+    Texture& atlas = bitmap.font.atlas;
 
-void RenderText(const char* text, Font& font, float fontSize, Vec2 position, Color color) {
-    textShader.use();
-    textShader.setMat4("projection", projection);
-    textShader.setVec3("textColor", glm::vec3(color.r, color.g, color.b));
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
 
-    glActiveTexture(GL_TEXTURE0);
-    textShader.setInt("text", 0);
-    glBindVertexArray(VAO);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RED,
+        atlas.width,
+        atlas.height,
+        0,
+        GL_RED,
+        GL_UNSIGNED_BYTE,
+        bitmap.atlasPixels.data()
+    );
+
+    atlas.id = texture;
+}
+
+Font* LoadFont(const char* path) {
+    FontBitmap bitmap;
+    if (!RasterizeFont(path, bitmap)) return nullptr;
+    UploadFontAtlas(bitmap);
+    return new Font(bitmap.font);
+}
 
+// Glyphs are queued into the renderer's quad batch, so a string (and every other string
+// and untextured rect drawn with the same font) goes out in a single instanced draw
+void RenderText(std::string_view text, Font& font, float fontSize, Vec2 position, Color color) {
     float scale = fontSize / baseFontSize;
-    size_t stringLength = strlen(text);
     Vec2 pen = position;
     pen.y += font.ascender;
 
-    for (int i = 0; text[i] != '\0'; ++i) {
-        char c = text[i];
+    for (char c : text) {
         if (c == '\n') {
             pen.x = position.x;
             pen.y += font.lineHeight;
@@ -137,54 +163,105 @@ void RenderText(const char* text, Font& font, float fontSize, Vec2 position, Col
         }
         if (c < ASCII_BEGIN || c >= ASCII_END) continue;
 
-        Character ch = font.characters[(int)c];
+        const Character& ch = font.characters[(int)c];
 
         Vec2 pos = pen;
         pos.x += ch.bearing.x * scale;
         pos.y -= ch.bearing.y * scale;
 
         Vec2 size = (Vec2)ch.glyphSize * scale;
-
-        float vertices[6][4] = {
-            {pos.x,          pos.y + size.y, 0.0f, 0.0f},
-            {pos.x,          pos.y,          0.0f, 1.0f},
-            {pos.x + size.x, pos.y,          1.0f, 1.0f},
-            {pos.x,          pos.y + size.y, 0.0f, 0.0f},
-            {pos.x + size.x, pos.y,          1.0f, 1.0f},
-            {pos.x + size.x, pos.y + size.y, 1.0f, 0.0f},
-        };
-
-        glBindTexture(GL_TEXTURE_2D, ch.textureID);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (size.x > 0.0f && size.y > 0.0f) DrawGlyph(pos, size, font.atlas, ch.uvOrigin, ch.uvSize, color);
 
         pen.x += (float)(ch.advance >> 6) * scale;
     }
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
-Vec2 MeasureText(const char* text, Font& font, float fontSize) {
-    Vec2 size = Vec2::zero;
-    size.y += font.lineHeight;
+static float Advance(const Font& font, char c, float scale) {
+    if (c < ASCII_BEGIN || c >= ASCII_END) return 0.0f;
+    return (float)(font.characters[(int)c].advance >> 6) * scale;
+}
 
+Vec2 MeasureText(std::string_view text, Font& font, float fontSize) {
+    Vec2 size = Vec2(0.0f, font.lineHeight);
     float scale = fontSize / baseFontSize;
-    size_t stringLength = strlen(text);
 
-    for (int i = 0; text[i] != '\0'; ++i) {
-        char c = text[i];
+    // The widest line, not the whole string laid end to end
+    float lineWidth = 0.0f;
+    for (char c : text) {
         if (c == '\n') {
+            size.x = std::max(size.x, lineWidth);
             size.y += font.lineHeight;
+            lineWidth = 0.0f;
             continue;
         }
-        if (c < ASCII_BEGIN || c >= ASCII_END) continue;
+        lineWidth += Advance(font, c, scale);
+    }
+    size.x = std::max(size.x, lineWidth);
+
+    return size;
+}
+
+Vec2 MeasureRuns(std::string_view text, Font& font, float fontSize, std::vector<TextRun>& runs) {
+    runs.clear();
+    float scale = fontSize / baseFontSize;
 
-        Character ch = font.characters[(int)c];
-        size.x += (float)(ch.advance >> 6) * scale;
+    Vec2 size = Vec2(0.0f, font.lineHeight);
+    float lineWidth = 0.0f;
+    size_t i = 0;
+    while (i < text.size()) {
+        TextRun run;
+        run.start = static_cast<uint32_t>(i);
+        for (; i < text.size() && text[i] != ' ' && text[i] != '\n'; ++i) run.width += Advance(font, text[i], scale);
+        run.length = static_cast<uint32_t>(i - run.start);
+        for (; i < text.size() && text[i] == ' '; ++i) run.spaceWidth += Advance(font, ' ', scale);
+        if (i < text.size() && text[i] == '\n') {
+            run.endsLine = true;
+            i++;
+        }
+        runs.push_back(run);
+
+        lineWidth += run.width + run.spaceWidth;
+        if (run.endsLine) {
+            size.x = std::max(size.x, lineWidth);
+            size.y += font.lineHeight;
+            lineWidth = 0.0f;
+        }
     }
+    size.x = std::max(size.x, lineWidth);
 
     return size;
-}
\ No newline at end of file
+}
+
+void BreakLines(const std::vector<TextRun>& runs, float maxWidth, std::vector<TextLine>& lines) {
+    lines.clear();
+
+    TextLine line;
+    bool isLineEmpty = true;
+    float pendingSpace = 0.0f;
+    for (const TextRun& run : runs) {
+        // A word that does not fit starts the next line, one wider than maxWidth on its own
+        // overflows rather than being split
+        if (!isLineEmpty && line.width + pendingSpace + run.width > maxWidth) {
+            lines.push_back(line);
+            isLineEmpty = true;
+        }
+
+        if (isLineEmpty) {
+            line = TextLine{ run.start, run.length, run.width };
+            isLineEmpty = false;
+        }
+        else {
+            line.length = run.start + run.length - line.start;
+            line.width += pendingSpace + run.width;
+        }
+        pendingSpace = run.spaceWidth;
+
+        if (run.endsLine) {
+            lines.push_back(line);
+            line = TextLine{ run.start + run.length, 0, 0.0f };
+            isLineEmpty = true;
+        }
+    }
+    // A trailing newline still leaves an empty last line, as MeasureText counts it
+    if (!isLineEmpty || runs.empty() || runs.back().endsLine) lines.push_back(line);
+}
@@ -2,23 +2,18 @@
 #include <iostream>
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include <renderer.h>
 #include <glad.h>
 #include <Debug.h>
 
-constexpr int MAX_TILES = 100000;
-
-struct TileInstance {
-    Vec2 worldPos;
-    uint32_t tileIndex;
-};
+// Enough for a handful of full chunks, the buffer grows as chunks come into view
+constexpr size_t INITIAL_TILE_INSTANCES = 4096;
 
 bool Tilemap::LoadTilemap(const char* filename, Shader* shader) {
-    tmx::Map map;
-    if (!map.load(filename)) {
-        std::string msg = "Error: Failed to load tilemap from \"" + std::string(filename) + "\"\n";
-        return false;
-    }
+    // The map's tiles, collision and objects are loaded the same way as any drafted level
+    std::unique_ptr<Level> baseLevel(LoadLevel(filename, Int2::down));
+    if (baseLevel == nullptr) return false;
 
     float quadVertices[] = {
         1.0f, 0.0f,     1.0f, 0.0f, // top right
@@ -35,7 +30,6 @@ bool Tilemap::LoadTilemap(const char* filename, Shader* shader) {
     glGenVertexArrays(1, &tileVAO);
     glGenBuffers(1, &quadVBO);
     glGenBuffers(1, &quadEBO);
-    glGenBuffers(1, &tileVBO);
 
     glBindVertexArray(tileVAO);
 
@@ -50,8 +44,7 @@ bool Tilemap::LoadTilemap(const char* filename, Shader* shader) {
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
 
-    glBindBuffer(GL_ARRAY_BUFFER, tileVBO);
-    glBufferData(GL_ARRAY_BUFFER, MAX_TILES * sizeof(TileInstance), nullptr, GL_DYNAMIC_DRAW);
+    tileBuffer.Create(INITIAL_TILE_INSTANCES * sizeof(TileInstance));
 
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(TileInstance), (void*)0);
     glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(TileInstance), (void*)(offsetof(TileInstance, tileIndex)));
@@ -61,103 +54,38 @@ bool Tilemap::LoadTilemap(const char* filename, Shader* shader) {
     glVertexAttribDivisor(3, 1);
 
     this->shader = shader;
+    uvStepUniform = shader->getUniform("uvStep");
+    tilesetColsUniform = shader->getUniform("tilesetCols");
+    projectionUniform = shader->getUniform("projection");
+    tileSizeUniform = shader->getUniform("tileSize");
 
-    tileSize = Int2((int)map.getTileSize().x, (int)map.getTileSize().y);
-
-    const auto& layers = map.getLayers();
-    for (const auto& layer : layers) {
-        if (layer->getType() == tmx::Layer::Type::Object) {
-            const auto& objectLayer = layer->getLayerAs<tmx::ObjectGroup>();
-            const auto& mapObjects = objectLayer.getObjects();
-            for (const auto& object : mapObjects) {
-                uint32_t tileID = object.getTileID();
-                if (tileID == 0) continue;
-
-                Int2 position = Int2(object.getPosition()) / tileSize + Int2::down;
-
-                ObjectType objType = stringToObjectType(object.getClass());
-                if (objType == ObjectType::Unknown) continue;
-
-                switch (objType) {
-                case ObjectType::Box:
-                    gameObjects.boxes[position] = Box(static_cast<uint32_t>(objects.size() + 1));
-                    break;
-                };
-                
-                objects[position] = ObjectData{
-                    position,
-                    tileSize,
-                    Vec2{ 0, 0 },
-                    objType,
-                    tileID,
-                    object.getRotation(),
-                    object.visible()
-                };
-            }
-        }
-        else if (layer->getType() == tmx::Layer::Type::Tile) {
-            const auto& tileLayer = layer->getLayerAs<tmx::TileLayer>();
-            if (tileLayer.getClass() == "CollisionMap") {
-                for (const auto& chunk : tileLayer.getChunks()) {
-                    const auto& tiles = chunk.tiles;
-                    for (int cy = 0; cy < chunk.size.y; ++cy) {
-                        for (int cx = 0; cx < chunk.size.x; ++cx) {
-                            const auto& tile = tiles[(size_t)cx + (size_t)cy * chunk.size.x];
-                            if (tile.ID != 0) {
-                                int worldX = chunk.position.x + cx;
-                                int worldY = chunk.position.y + cy;
-                                collisionMap.insert(Int2{ worldX, worldY });
-                            }
-                        }
-                    }
-                }
-            }
-            else {
-                std::vector<Chunk> chunks;
-                for (auto& chunk : tileLayer.getChunks()) {
-                    chunks.push_back(Chunk{
-                        Int2(chunk.position.x, chunk.position.y),
-                        Int2(chunk.size.x, chunk.size.y),
-                        chunk.tiles
-                    });
-                }
-                Vec2 offset = Vec2{
-                    (float)tileLayer.getOffset().x,
-
-                    (float)tileLayer.getOffset().y
-                };
-                this->layers.push_back(ChunkLayer{chunks, offset});
-            }
-        }
-    }
+    tileSize = baseLevel->tileSize;
+    state.AddLevel(*baseLevel, Int2::zero);
+    layers = std::move(baseLevel->layers);
 
-    const auto& tilesets = map.getTilesets();
+    const std::vector<TilesetInfo>& tilesets = baseLevel->tilesets;
 
     if (tilesets.empty()) return false;
 
-    uint32_t maxGID = tilesets.back().getLastGID();
+    uint32_t maxGID = tilesets.back().lastGID;
     size_t newSize = static_cast<size_t>(maxGID) + 1;
     tileLookup.resize(newSize, {});
 
-    for (const auto& tileset : tilesets) {
-        uint32_t first = tileset.getFirstGID();
-        uint32_t count = tileset.getTileCount();
+    for (const TilesetInfo& tileset : tilesets) {
+        uint32_t first = tileset.firstGID;
+        uint32_t count = tileset.tileCount;
 
-        std::string texPath = tileset.getImagePath();
-        Texture texture = LoadTexture(texPath.c_str());
+        Texture texture = LoadTexture(tileset.imagePath.c_str());
 
         shader->setInt("texture1", 0);
 
         tilesetLookup.push_back(TilesetLookup{ tileset, first, first + count, texture });
 
         for (uint32_t i = 0; i < count; ++i) {
-            const tmx::Tileset::Tile* tile = tileset.getTile(i);
-            if (tile == nullptr) continue;
+            if (!tileset.HasTile(i)) continue;
             tileLookup[(size_t)first + i - 1] = TileInfo{
-                tile,
                 tilesetLookup.size() - 1,
-                first + i,
-                tile->properties
+                first + i
             };
         }
     }
@@ -165,13 +93,8 @@ bool Tilemap::LoadTilemap(const char* filename, Shader* shader) {
     return true;
 }
 
-std::optional<Chunk> Tilemap::GetChunk(Int2 pos, int layer) const {
-    for (Chunk chunk : layers[layer].chunks) {
-        if (pos / chunk.size == chunk.position) {
-            return chunk;
-        }
-    }
-    return std::nullopt;
+const Chunk* Tilemap::GetChunk(Int2 pos, int layer) const {
+    return layers[layer].FindChunk(pos);
 }
 
 std::optional<tmx::TileLayer::Tile> Tilemap::GetTile(int posX, int posY, int layer) const {
@@ -179,39 +102,28 @@ std::optional<tmx::TileLayer::Tile> Tilemap::GetTile(int posX, int posY, int lay
 }
 
 std::optional<tmx::TileLayer::Tile> Tilemap::GetTile(Int2 pos, int layer) const {
-    std::optional<Chunk> chunk = GetChunk(pos, layer);
-    if (!chunk.has_value()) return std::nullopt;
+    const Chunk* chunk = GetChunk(pos, layer);
+    if (chunk == nullptr) return std::nullopt;
 
     Int2 tileChunkPos = pos - chunk->position;
-    int idx = tileChunkPos.x + tileChunkPos.y * chunk->size.x;
+    if (tileChunkPos.x < 0 || tileChunkPos.y < 0 || tileChunkPos.x >= chunk->size.x || tileChunkPos.y >= chunk->size.y) {
+        return std::nullopt;
+    }
+    size_t idx = (size_t)tileChunkPos.x + (size_t)tileChunkPos.y * chunk->size.x;
+    if (idx >= chunk->tiles.size()) return std::nullopt;
     return chunk->tiles[idx];
 }
 
 const TileInfo* Tilemap::GetTileInfo(uint32_t GID) const {
     if (GID == 0) return nullptr;
     if (GID >= tileLookup.size()) return nullptr;
-    if (!tileLookup[GID].tile) return nullptr;
+    if (tileLookup[GID].GID == 0) return nullptr;
 
     return &tileLookup[GID];
 }
 
-bool Tilemap::IsSolid(Int2 pos) const {
-    return collisionMap.count(pos) != 0;
-}
-
 bool Tilemap::CanPlaceLevel(const Level& level, Int2 position) {
-    size_t layerCount = level.layers.size();
-    if (layerCount != this->layers.size()) return false;
-    if (position % level.layers.at(0).chunks.at(0).size != Int2::zero) return false;
-
-    for (size_t i = 0; i < layerCount; i++) {
-        for (const Chunk& levelChunk : level.layers[i].chunks) {
-            for (const Chunk& worldChunk : layers[i].chunks) {
-                if (levelChunk.position == worldChunk.position) return false;
-            }
-        }
-    }
-    return true;
+    return ::CanPlaceLevel(layers, level, position);
 }
 
 Vec2 Tilemap::TilemapToWorldPos(Int2 tilemapPos, int layer) const {
@@ -222,61 +134,112 @@ Int2 Tilemap::WorldToTilemapPos(Vec2 worldPos, int layer) const {
     return Int2(worldPos - layers[layer].offset) / tileSize;
 }
 
-void Tilemap::Render(int layer) const {
+void Tilemap::UploadChunkMesh(const Chunk& chunk, ChunkMesh& mesh) const {
+    instanceScratch.clear();
 
-    std::vector<TileInstance> tiles;
+    int chunkWidth = chunk.size.x;
+    for (int i = 0; i < chunk.tiles.size(); ++i) {
+        const TileInfo* tileInfo = GetTileInfo(chunk.tiles[i].ID);
+        if (!tileInfo || tileInfo->GID == 0) continue;
 
-    TilesetLookup tileset = tilesetLookup.front();
+        Int2 tilePos = chunk.position + Int2(i % chunkWidth, i / chunkWidth);
+        instanceScratch.push_back(TileInstance{ tilePos * tileSize, tileInfo->GID - 2 });
+    }
 
-    for (Chunk chunk : layers[layer].chunks) {
-        for (int i = 0; i < chunk.tiles.size(); ++i) {
-            int chunkWidth = chunk.size.x;
-            Int2 tilePos = chunk.position + Int2(i % chunkWidth, i / chunkWidth);
+    // Slots are sized for a full chunk so later re-uploads always fit in place
+    if (mesh.firstInstance == ChunkMesh::NO_SLOT) {
+        mesh.firstInstance = nextInstanceSlot;
+        nextInstanceSlot += static_cast<uint32_t>(chunk.tiles.size());
+        tileBuffer.Reserve(nextInstanceSlot * sizeof(TileInstance), true);
+    }
 
-            const TileInfo* tileInfo = GetTileInfo(chunk.tiles[i].ID);
-            if (!tileInfo || tileInfo->GID == 0) continue;
+    tileBuffer.Upload(mesh.firstInstance * sizeof(TileInstance), instanceScratch.data(), instanceScratch.size() * sizeof(TileInstance));
 
-            Vec2 halfTileOffset = Vec2{ -0.5f, -0.5f } * (Vec2)tileSize;
-            Vec2 worldOffset = layers[layer].offset + halfTileOffset;
-            Vec2 worldPos = tilePos * tileSize;
+    mesh.instanceCount = static_cast<uint32_t>(instanceScratch.size());
+    mesh.dirty = false;
+}
 
-            tiles.push_back(TileInstance{ worldPos, tileInfo->GID - 2 });
-        }
-    }
+void Tilemap::Render(int layer) const {
+    FlushRenderer();
+
+    const TilesetLookup& tileset = tilesetLookup.front();
+    const ChunkLayer& chunkLayer = layers[layer];
+
+    if (chunkMeshes.size() < layers.size()) chunkMeshes.resize(layers.size());
+    std::vector<ChunkMesh>& meshes = chunkMeshes[layer];
+
+    // Chunks added since the last frame get a slot in the instance buffer when first drawn
+    meshes.resize(chunkLayer.chunks.size());
 
     glBindVertexArray(tileVAO);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, tileset.texture.id);
 
-    glBindBuffer(GL_ARRAY_BUFFER, tileVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, tiles.size() * sizeof(TileInstance), tiles.data());
-
-    Vec2 imageSize = tileset.tileset.getImageSize();
+    Vec2 imageSize = (Vec2)tileset.tileset.imageSize;
     Vec2 uvStep = (Vec2)tileSize / imageSize;
 
     shader->use();
-    shader->setVec2("uvStep", uvStep);
-    shader->setInt("tilesetCols", static_cast<int>(tileset.tileset.getColumnCount()));
-    shader->setMat4("projection", projection);
-    shader->setInt("tileSize", tileSize.x);
+    shader->setVec2(uvStepUniform, uvStep);
+    shader->setInt(tilesetColsUniform, static_cast<int>(tileset.tileset.columns));
+    shader->setMat4(projectionUniform, projection);
+    shader->setInt(tileSizeUniform, tileSize.x);
+
+    Rect view = GetVisibleRect();
+    glBindBuffer(GL_ARRAY_BUFFER, tileBuffer.id);
+
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const Chunk& chunk = chunkLayer.chunks[i];
+        Rect chunkRect = Rect(chunk.position * tileSize, chunk.size * tileSize);
+        if (!RectsOverlap(view, chunkRect)) {
+            frameStats.chunksCulled++;
+            continue;
+        }
+        frameStats.chunksDrawn++;
 
+        // Dirty chunks that are off screen wait until they scroll into view
+        ChunkMesh& mesh = meshes[i];
+        if (mesh.dirty) UploadChunkMesh(chunk, mesh);
+        if (mesh.instanceCount == 0) continue;
 
-    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)tiles.size());
+        // GL 3.3 has no base instance, so point the instance attributes at this chunk's slot
+        size_t slotOffset = mesh.firstInstance * sizeof(TileInstance);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(TileInstance), (void*)slotOffset);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(TileInstance), (void*)(slotOffset + offsetof(TileInstance, tileIndex)));
+
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)mesh.instanceCount);
+        frameStats.drawCalls++;
+    }
 
     glBindVertexArray(0);
 
-    for (const auto &pair : objects) {
-        DrawObject(pair.second, layer);
+    const Pushables& boxes = state.gameObjects.boxes;
+    for (size_t id = 0; id < boxes.Size(); ++id) {
+        const ObjectData& object = boxes.drawData[id];
+        Rect objectRect = Rect(TilemapToWorldPos(boxes.position[id]) + boxes.offset[id], object.size);
+        if (!RectsOverlap(view, objectRect)) {
+            frameStats.objectsCulled++;
+            continue;
+        }
+        frameStats.objectsDrawn++;
+        DrawObject(object, boxes.position[id], boxes.offset[id], layer);
     }
 }
 
+void Tilemap::MarkChunkDirty(Int2 pos, int layer) {
+    const Chunk* chunk = GetChunk(pos, layer);
+    if (chunk == nullptr || (size_t)layer >= chunkMeshes.size()) return;
+
+    size_t slot = chunk - layers[layer].chunks.data();
+    if (slot < chunkMeshes[layer].size()) chunkMeshes[layer][slot].dirty = true;
+}
+
 void Tilemap::DrawTile(TileInfo tileInfo, Int2 pos, int layer, Vec2 offset) const {
     Vec2 worldOffset = layers[0].offset + offset;
     Vec2 worldPos = (Vec2)(pos * tileSize) + worldOffset;
 
     const TilesetLookup& tileset = tilesetLookup.front();
     int tileIndex = tileInfo.GID - 2;
-    int tilesetCols = tileset.tileset.getColumnCount();
+    int tilesetCols = static_cast<int>(tileset.tileset.columns);
     int col = tileIndex % tilesetCols;
     int row = tileIndex / tilesetCols;
     Vec2 baseUV = Vec2(col, row) * (Vec2)tileSize;
@@ -289,63 +252,16 @@ void Tilemap::DrawTile(uint32_t GID, Int2 pos, int layer, Vec2 offset) const {
     DrawTile(*tileInfo, pos, layer, offset);
 }
 
-void Tilemap::DrawObject(ObjectData object, int layer) const {
+void Tilemap::DrawObject(const ObjectData& object, Int2 position, Vec2 offset, int layer) const {
     if (!object.visible) return;
 
-    DrawTile(object.tileGID, object.position, layer, object.offset);
-}
-
-template<typename ObjT>
-void Tilemap::AddGameObject(ObjT gameObject, ObjectData objectData) {
-    if constexpr (std::is_same_v<ObjT, Box>) {
-        gameObject.ID = objects.size();
-        gameObjects.boxes[objectData.position] = gameObject;
-    }
-    else return;
-
-    objects[objectData.position] = objectData;
+    DrawTile(object.tileGID, position, layer, offset);
 }
 
-void Tilemap::AddGameObject(ObjectData objectData) {
-    switch (objectData.type) {
-    case ObjectType::Box:
-        gameObjects.boxes[objectData.position] = Box(static_cast<uint32_t>(objects.size() + 1));
-        break;
-    default: return;
-    }
-
-    objects[objectData.position] = objectData;
-}
+bool Tilemap::AddLevel(const Level& level, Int2 position) {
+    if (!CanPlaceLevel(level, position)) return false;
 
-void Tilemap::AddLevel(const Level& level, Int2 position) {
-    size_t layerCount = level.layers.size();
-    if (layerCount != this->layers.size()) return;
-
-    for (size_t i = 0; i < layerCount; i++) {
-        std::transform(
-            level.layers[i].chunks.begin(),
-            level.layers[i].chunks.end(),
-            std::back_inserter(this->layers[i].chunks),
-            [position](const Chunk& levelChunk) {
-                Chunk newChunk = levelChunk;
-                newChunk.position += position;
-                return newChunk;
-            }
-        );
-    }
-
-    std::transform(
-        level.collisionMap.begin(),
-        level.collisionMap.end(),
-        std::inserter(this->collisionMap, this->collisionMap.end()),
-        [position](const Int2& solid) {
-            return solid + position;
-        }
-    );
-
-    for (const ObjectData& object : level.objects) {
-        ObjectData newObject = object;
-        newObject.position += position;
-        AddGameObject(newObject);
-    }
+    StampLevelLayers(layers, level, position);
+    state.AddLevel(level, position);
+    return true;
 }
@@ -1,10 +1,85 @@
 #include <ui.h>
 #include <cmath>
+#include <bit>
 #include <Debug.h>
 
+// Layout cache entries nobody has used for this many frames are dropped
+constexpr uint32_t CACHE_SWEEP_INTERVAL = 120;
+
+static uint64_t HashCombine(uint64_t hash, uint64_t value) {
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 31;
+    return hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
+
+static uint64_t HashFloat(uint64_t hash, float value) {
+    return HashCombine(hash, std::bit_cast<uint32_t>(value));
+}
+
+static uint64_t HashString(uint64_t hash, std::string_view text) {
+    for (char c : text) hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+    return HashCombine(hash, text.size());
+}
+
+// Only the fields layout reads, colours and borders can change without a re-layout
+static uint64_t HashLayoutStyle(const UI::Style& style) {
+    uint64_t hash = 1469598103934665603ull;
+    hash = HashCombine(hash, style.image.id);
+    hash = HashCombine(hash, static_cast<uint64_t>(style.image.width) << 32 | static_cast<uint32_t>(style.image.height));
+    hash = HashCombine(hash, static_cast<uint64_t>(style.sizing.width.mode) << 8 | static_cast<uint64_t>(style.sizing.height.mode));
+    hash = HashFloat(hash, style.sizing.width.value);
+    hash = HashFloat(hash, style.sizing.height.value);
+    for (const UI::Spacing& spacing : { style.padding, style.margin }) {
+        hash = HashFloat(hash, spacing.left);
+        hash = HashFloat(hash, spacing.top);
+        hash = HashFloat(hash, spacing.right);
+        hash = HashFloat(hash, spacing.bottom);
+    }
+    hash = HashFloat(hash, style.positioning.position.x);
+    hash = HashFloat(hash, style.positioning.position.y);
+    hash = HashCombine(hash, static_cast<uint64_t>(style.positioning.mode) << 24 | static_cast<uint64_t>(style.flexDir) << 16
+        | static_cast<uint64_t>(style.alignX) << 8 | static_cast<uint64_t>(style.alignY));
+    hash = HashFloat(hash, style.childGap);
+    hash = HashCombine(hash, reinterpret_cast<uintptr_t>(style.font));
+    hash = HashFloat(hash, style.fontSize);
+    hash = HashFloat(hash, style.fontSpacing);
+    return HashCombine(hash, style.isWrap);
+}
+
+// Water-fills the space into the growable children: the smallest rise together until they
+// reach the next smallest, then those rise together, and so on. One sort and one pass, so it
+// is O(n log n) in the children and always finishes.
+static void GrowEvenly(std::vector<UI::Element*>& growable, float remaining, float Vec2::* axis) {
+    std::sort(growable.begin(), growable.end(), [axis](const UI::Element* a, const UI::Element* b) {
+        return a->size.*axis < b->size.*axis;
+    });
+
+    float level = growable.front()->size.*axis;
+    size_t raised = 1;
+    while (raised < growable.size()) {
+        float next = growable[raised]->size.*axis;
+        float cost = (next - level) * static_cast<float>(raised);
+        if (cost >= remaining) break;
+        remaining -= cost;
+        level = next;
+        raised++;
+    }
+    level += remaining / static_cast<float>(raised);
+
+    for (size_t i = 0; i < raised; ++i) growable[i]->size.*axis = level;
+}
+
+// Same inputs as last frame, the final size still has to be checked against the entry
+static bool MatchesCache(const UI::Element* element) {
+    return element->cacheable && element->cache != nullptr && element->cache->subtreeHash == element->subtreeHash;
+}
+
 void UIContext::BeginUI(Vec2 currentScreenSize, UI::MouseState currentFrameMouseState, UI::FlexDir rootFlexDir) {
     elementArena.clear();
     elementStack.clear();
+    frame++;
+    elementCount = 0;
+    relayoutCount = 0;
 
     screenSize = currentScreenSize;
     mouseState = currentFrameMouseState;
@@ -20,23 +95,33 @@ void UIContext::EndUI() {
     isContextActive = false;
 
     GrowWidths();
-    WrapText();
+    WrapText(root);
     FitHeights(root);
     GrowHeights();
     LayoutElements();
+    StoreLayout();
     ResolveCallbacks();
+
+    if (frame % CACHE_SWEEP_INTERVAL == 0) {
+        std::erase_if(layoutCache, [this](const auto& entry) { return entry.second.lastFrame + CACHE_SWEEP_INTERVAL < frame; });
+    }
 }
 
 void UIContext::OpenElement(const UI::Style& style) {
     if (!isContextActive) return;
 
     UI::Element* element = elementArena.alloc<UI::Element>();
-    if (element == nullptr) return;
 
     if (!elementStack.empty()) {
         element->parent = elementStack.back();
-        elementStack.back()->children.push_back(element);
+        UI::Element* parent = element->parent;
+        element->id = UI::GetElementID(parent->childCount, parent);
+        if (parent->lastChild != nullptr) parent->lastChild->nextSibling = element;
+        else parent->firstChild = element;
+        parent->lastChild = element;
+        parent->childCount++;
     }
+    elementCount++;
 
     element->style = style;
     if (style.positioning.mode == UI::PositionMode::ABSOLUTE) element->position = style.positioning.position;
@@ -53,13 +138,41 @@ void UIContext::CloseElement() {
     elementStack.pop_back();
     UI::Element* parent = element->parent;
 
+    // Children close first, so their hashes are ready to fold into this one. Two elements
+    // sharing an id can't share an entry, the second one just goes without.
+    UI::CachedLayout& cached = layoutCache[element->id];
+    if (cached.lastFrame != frame) {
+        cached.lastFrame = frame;
+        element->cache = &cached;
+    }
+    else element->cacheable = false;
+
+    uint64_t hash = HashString(HashLayoutStyle(element->style), element->label);
+    for (UI::Element* child : element->children()) {
+        hash = HashCombine(hash, child->subtreeHash);
+        element->cacheable = element->cacheable && child->cacheable;
+    }
+    element->subtreeHash = HashCombine(hash, element->childCount);
+
     if (parent == nullptr) return;
 
     if (element->isText()) {
-        element->size = MeasureText(element->label.c_str(), *element->style.font, element->style.fontSize);
+        uint64_t textHash = HashFloat(HashString(reinterpret_cast<uintptr_t>(element->style.font), element->label), element->style.fontSize);
+        UI::CachedLayout* cached = element->cache;
+        if (cached == nullptr) {
+            element->size = MeasureText(element->label, *element->style.font, element->style.fontSize);
+        }
+        else {
+            if (cached->textHash != textHash) {
+                cached->measured = MeasureRuns(element->label, *element->style.font, element->style.fontSize, cached->runs);
+                cached->textHash = textHash;
+                cached->wrapWidth = -1.0f;
+            }
+            element->size = cached->measured;
+        }
     }
 
-    float totalChildGap = fmaxf(static_cast<float>(element->children.size()) - 1, 0) * element->style.childGap;
+    float totalChildGap = fmaxf(static_cast<float>(element->childCount) - 1, 0) * element->style.childGap;
 
 
     if (element->style.sizing.width.mode == UI::SizingMode::FIT) {
@@ -84,19 +197,26 @@ void UIContext::FitHeights(UI::Element* element) {
     if (element == nullptr) return;
     UI::Element* parent = element->parent;
 
-    for (auto* child : element->children) FitHeights(child);
+    if (element->widthReused) {
+        // Same content at the same width fits the same as it did last frame
+        element->size.y = element->cache->fitHeight;
+    }
+    else {
+        for (auto* child : element->children()) FitHeights(child);
 
-    float totalChildGap = fmaxf(static_cast<float>(element->children.size()) - 1, 0) * element->style.childGap;
+        float totalChildGap = fmaxf(static_cast<float>(element->childCount) - 1, 0) * element->style.childGap;
 
-    if (element->style.sizing.height.mode == UI::SizingMode::FIT) {
-        Texture image = element->style.image;
-        if (image.id != 0) {
-            element->size.y = (float)image.height;
-        } else {
-            element->size.y += element->style.padding.top + element->style.padding.bottom;
-            if (element->style.flexDir == UI::FlexDir::COLUMN) element->size.y += totalChildGap;
+        if (element->style.sizing.height.mode == UI::SizingMode::FIT) {
+            Texture image = element->style.image;
+            if (image.id != 0) {
+                element->size.y = (float)image.height;
+            } else {
+                element->size.y += element->style.padding.top + element->style.padding.bottom;
+                if (element->style.flexDir == UI::FlexDir::COLUMN) element->size.y += totalChildGap;
+            }
         }
     }
+    element->fitHeight = element->size.y;
 
     if (parent == nullptr) return;
 
@@ -108,16 +228,25 @@ void UIContext::FitHeights(UI::Element* element) {
     }
 }
 
-void UIContext::WrapText() {
-    elementStack.clear();
-    elementStack.push_back(root);
-    while (!elementStack.empty()) {
-        UI::Element* element = elementStack.back();
-        elementStack.pop_back();
-        for (UI::Element* child : element->children) elementStack.push_back(child);
+// Recursive rather than on elementStack, GrowHeights calls it partway through its own walk
+void UIContext::WrapText(UI::Element* element) {
+    if (element->widthReused) return;
+    for (UI::Element* child : element->children()) WrapText(child);
+    if (element->isText()) element->isWrapped = WrapLines(element);
+}
+
+// Breaks a text element to its final width and sets its height to the lines it took.
+// Returns false when it is left as one line per newline.
+bool UIContext::WrapLines(UI::Element* element) {
+    UI::CachedLayout* cached = element->cache;
+    if (!element->style.isWrap || cached == nullptr || element->size.x >= cached->measured.x) return false;
 
-        if (!element->isText() || !element->style.isWrap) continue;
+    if (cached->wrapWidth != element->size.x) {
+        BreakLines(cached->runs, element->size.x, cached->lines);
+        cached->wrapWidth = element->size.x;
     }
+    element->size.y = static_cast<float>(cached->lines.size()) * element->style.font->lineHeight;
+    return true;
 }
 
 void UIContext::GrowWidths() {
@@ -126,54 +255,37 @@ void UIContext::GrowWidths() {
     while (!elementStack.empty()) {
         UI::Element* element = elementStack.back();
         elementStack.pop_back();
-        for (UI::Element* child : element->children) elementStack.push_back(child);
+
+        // Its width is final by now, and at the same width the same subtree lays out the same
+        if (MatchesCache(element) && element->cache->size.x == element->size.x) {
+            element->widthReused = true;
+            continue;
+        }
+        for (UI::Element* child : element->children()) elementStack.push_back(child);
 
         bool isFlexRow = element->style.flexDir == UI::FlexDir::ROW;
 
         float remainingWidth = element->width();
         remainingWidth -= element->style.padding.left + element->style.padding.right;
 
-        std::vector<UI::Element*> growableWidths;
-        for (UI::Element* child : element->children) {
+        growable.clear();
+        for (UI::Element* child : element->children()) {
             if (isFlexRow) remainingWidth -= child->width() + child->style.margin.left + child->style.margin.right;
-            if (child->style.sizing.width.mode == UI::SizingMode::GROW) growableWidths.push_back(child);
+            if (child->style.sizing.width.mode == UI::SizingMode::GROW) growable.push_back(child);
         }
 
-        if (growableWidths.empty()) continue;
+        if (growable.empty()) continue;
 
         if (!isFlexRow) {
-            for (auto* child : growableWidths) {
+            for (auto* child : growable) {
                 child->size.x = remainingWidth - child->style.margin.left - child->style.margin.right;
             }
             continue;
         }
         
-        remainingWidth -= fmaxf(static_cast<float>(element->children.size()) - 1, 0) * element->style.childGap;
-
-        while (remainingWidth > EPSILON) {
-            float smallestWidth = growableWidths.front()->width();
-            float secondSmallestWidth = std::numeric_limits<float>::max();
-            float widthToAdd = remainingWidth;
-            for (auto* child : growableWidths) {
-                if (child->width() < smallestWidth) {
-                    secondSmallestWidth = smallestWidth;
-                    smallestWidth = child->width();
-                }
-                if (child->width() > smallestWidth) {
-                    secondSmallestWidth = fminf(secondSmallestWidth, child->width());
-                    widthToAdd = secondSmallestWidth - smallestWidth;
-                }
-            }
-
-            widthToAdd = fminf(widthToAdd, remainingWidth / growableWidths.size());
+        remainingWidth -= fmaxf(static_cast<float>(element->childCount) - 1, 0) * element->style.childGap;
 
-            for (auto* child : growableWidths) {
-                if (Approximately(child->width(), smallestWidth)) {
-                    child->size.x += widthToAdd;
-                    remainingWidth -= widthToAdd;
-                }
-            }
-        }
+        if (remainingWidth > 0.0f) GrowEvenly(growable, remainingWidth, &Vec2::x);
     }
 }
 
@@ -183,54 +295,45 @@ void UIContext::GrowHeights() {
     while (!elementStack.empty()) {
         UI::Element* element = elementStack.back();
         elementStack.pop_back();
-        for (UI::Element* child : element->children) elementStack.push_back(child);
+
+        if (element->widthReused) {
+            if (element->cache->size.y == element->size.y) {
+                element->reused = true;
+                continue;
+            }
+            // Grown to a new height, so the heights under it have to be worked out again
+            RestoreWidths(element);
+            element->widthReused = false;
+            WrapText(element);
+            float height = element->size.y;
+            for (UI::Element* child : element->children()) FitHeights(child);
+            element->size.y = height;
+        }
+        for (UI::Element* child : element->children()) elementStack.push_back(child);
 
         bool isFlexColumn = element->style.flexDir == UI::FlexDir::COLUMN;
 
         float remainingHeight = element->height();
         remainingHeight -= element->style.padding.top + element->style.padding.bottom;
 
-        std::vector<UI::Element*> growableHeights;
-        for (UI::Element* child : element->children) {
+        growable.clear();
+        for (UI::Element* child : element->children()) {
             if (isFlexColumn) remainingHeight -= child->height() + child->style.margin.top + child->style.margin.bottom;
-            if (child->style.sizing.height.mode == UI::SizingMode::GROW) growableHeights.push_back(child);
+            if (child->style.sizing.height.mode == UI::SizingMode::GROW) growable.push_back(child);
         }
 
-        if (growableHeights.empty()) continue;
+        if (growable.empty()) continue;
 
         if (!isFlexColumn) {
-            for (auto* child : growableHeights) {
+            for (auto* child : growable) {
                 child->size.y = remainingHeight - child->style.margin.top - child->style.margin.bottom;
             }
             continue;
         }
 
-        remainingHeight -= fmaxf(static_cast<float>(element->children.size()) - 1, 0) * element->style.childGap;
-
-        while (remainingHeight > EPSILON) {
-            float smallestHeight = growableHeights.front()->height();
-            float secondSmallestHeight = std::numeric_limits<float>::max();
-            float heightToAdd = remainingHeight;
-            for (auto* child : growableHeights) {
-                if (child->height() < smallestHeight) {
-                    secondSmallestHeight = smallestHeight;
-                    smallestHeight = child->height();
-                }
-                if (child->height() > smallestHeight) {
-                    secondSmallestHeight = fminf(secondSmallestHeight, child->height());
-                    heightToAdd = secondSmallestHeight - smallestHeight;
-                }
-            }
+        remainingHeight -= fmaxf(static_cast<float>(element->childCount) - 1, 0) * element->style.childGap;
 
-            heightToAdd = fminf(heightToAdd, remainingHeight / growableHeights.size());
-
-            for (auto* child : growableHeights) {
-                if (Approximately(child->height(), smallestHeight)) {
-                    child->size.y += heightToAdd;
-                    remainingHeight -= heightToAdd;
-                }
-            }
-        }
+        if (remainingHeight > 0.0f) GrowEvenly(growable, remainingHeight, &Vec2::y);
     }
 }
 
@@ -262,13 +365,19 @@ void UIContext::LayoutElements() {
                 break;
             }
         }
-        if (element->children.empty()) continue;
-        for (UI::Element* child : element->children) elementStack.push_back(child);
+        if (element->reused) {
+            if (element->isText()) element->isWrapped = WrapLines(element);
+            RestoreLayout(element);
+            continue;
+        }
+        relayoutCount++;
+        if (element->childCount == 0) continue;
+        for (UI::Element* child : element->children()) elementStack.push_back(child);
 
         bool isFlexRow = element->style.flexDir == UI::FlexDir::ROW;
 
         float totalAlongSize = 0.0f;
-        for (UI::Element* child : element->children) {
+        for (UI::Element* child : element->children()) {
             totalAlongSize += isFlexRow ? child->size.x : child->size.y;
         }
 
@@ -279,7 +388,7 @@ void UIContext::LayoutElements() {
         float acrossOffset = 0.0f;
         float cursor = isFlexRow ? element->style.padding.left : element->style.padding.top;
 
-        for (UI::Element* child : element->children) {
+        for (UI::Element* child : element->children()) {
             if (child->style.positioning.mode == UI::PositionMode::ABSOLUTE) continue;
 
             child->position += element->position;
@@ -297,22 +406,63 @@ void UIContext::LayoutElements() {
     }
 }
 
+void UIContext::RestoreWidths(UI::Element* element) {
+    for (UI::Element* child : element->children()) {
+        child->size.x = child->cache->size.x;
+        RestoreWidths(child);
+    }
+}
+
+void UIContext::RestoreLayout(UI::Element* element) {
+    for (UI::Element* child : element->children()) {
+        bool isAbsolute = child->style.positioning.mode == UI::PositionMode::ABSOLUTE;
+        child->size = child->cache->size;
+        child->position = (isAbsolute ? Vec2::zero : element->position) + child->cache->offset;
+        // Same text at the same width, so this finds last frame's lines without breaking again
+        if (child->isText()) child->isWrapped = WrapLines(child);
+        RestoreLayout(child);
+    }
+}
+
+void UIContext::StoreLayout() {
+    elementStack.clear();
+    elementStack.push_back(root);
+    while (!elementStack.empty()) {
+        UI::Element* element = elementStack.back();
+        elementStack.pop_back();
+
+        UI::CachedLayout* cached = element->cache;
+        if (cached != nullptr) {
+            bool isAbsolute = element->style.positioning.mode == UI::PositionMode::ABSOLUTE;
+            cached->subtreeHash = element->subtreeHash;
+            cached->fitHeight = element->fitHeight;
+            cached->size = element->size;
+            cached->offset = isAbsolute || element->parent == nullptr
+                ? element->position
+                : element->position - element->parent->position;
+        }
+        // The rest of a reused subtree already matches its entries, only its root can have moved
+        if (element->reused) continue;
+        for (UI::Element* child : element->children()) elementStack.push_back(child);
+    }
+}
+
 void UIContext::ResolveCallbacks() {
     elementStack.clear();
     elementStack.push_back(root);
     while (!elementStack.empty()) {
         UI::Element* curr = elementStack.back();
         elementStack.pop_back();
-        for (UI::Element* child : curr->children) elementStack.push_back(child);
+        for (UI::Element* child : curr->children()) elementStack.push_back(child);
 
         if (PointInRect(mouseState.mousePos, curr->position, curr->size, curr->style.roundness)) {
             hotID = curr->id;
-            if (curr->onHover != nullptr) curr->onHover(*curr);
+            if (curr->onHover) curr->onHover(*curr);
             if (mouseState.left.down) {
                 activeID = curr->id;
-                if (curr->onActive != nullptr) curr->onActive(*curr);
+                if (curr->onActive) curr->onActive(*curr);
             }
-            if (curr->onClick != nullptr && mouseState.left.released && activeID == curr->id) {
+            if (curr->onClick && mouseState.left.released && activeID == curr->id) {
                 curr->onClick(*curr);
             }
         }
@@ -326,7 +476,16 @@ void UIContext::Render(UI::Element* element) {
     const UI::Style& style = element->style;
 
     if (element->isText()) {
-        RenderText(element->label.c_str(), *element->style.font, element->style.fontSize, element->position, element->style.textColor);
+        if (element->isWrapped) {
+            Vec2 pen = element->position;
+            for (const TextLine& line : element->cache->lines) {
+                RenderText(element->label.substr(line.start, line.length), *style.font, style.fontSize, pen, style.textColor);
+                pen.y += style.font->lineHeight;
+            }
+        }
+        else {
+            RenderText(element->label, *style.font, style.fontSize, element->position, style.textColor);
+        }
     }
     else {
         Texture image = element->style.image;
@@ -340,7 +499,7 @@ void UIContext::Render(UI::Element* element) {
         }
     }
 
-    for (UI::Element* element : element->children) {
+    for (UI::Element* element : element->children()) {
         Render(element);
     }
 }
@@ -354,29 +513,23 @@ void UIContext::Panel(const UI::PanelStyle& style) {
     CloseElement();
 }
 
-void UIContext::Panel(const UI::PanelStyle& style, const std::function<void()> children) {
-
+void UIContext::Panel(const UI::PanelStyle& style, const UI::Callbacks& callbacks) {
     OpenElement(style.toStyle());
-    children();
+    UI::AddCallbacks(elementArena, elementStack.back(), callbacks);
     CloseElement();
 }
 
-void UIContext::Panel(const UI::PanelStyle& style, UI::Callbacks callbacks) {
-    OpenElement(style.toStyle());
-    UI::AddCallbacks(elementStack.back(), callbacks);
-    CloseElement();
-}
 
-void UIContext::Panel(const UI::PanelStyle& style, UI::Callbacks callbacks, const std::function<void()> children) {
+void UIContext::Text(std::string_view text, const UI::TextStyle& style) {
     OpenElement(style.toStyle());
-    UI::AddCallbacks(elementStack.back(), callbacks);
-    children();
+    UI::Element* element = elementStack.back();
+    element->label = InternLabel(text);
     CloseElement();
 }
 
-void UIContext::Text(std::string text, const UI::TextStyle& style) {
-    OpenElement(style.toStyle());
-    UI::Element* element = elementStack.back();
-    element->label = text;
-    CloseElement();
+std::string_view UIContext::InternLabel(std::string_view text) {
+    char* storage = static_cast<char*>(elementArena.allocBytes(text.size() + 1, alignof(char)));
+    std::memcpy(storage, text.data(), text.size());
+    storage[text.size()] = '\0';
+    return std::string_view(storage, text.size());
 }
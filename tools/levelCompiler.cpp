@@ -0,0 +1,54 @@
+#include <levels.h>
+#include <levelCache.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Compiles .tmx maps into the binary level cache LoadLevel picks up next to them.
+// Pass map files or directories to search for them, res/ by default. Run from the same
+// directory as the game so tileset image paths resolve the way it will load them.
+
+static bool CompileLevel(const std::string& tmxFile) {
+    tmx::Map map;
+    if (!map.load(tmxFile)) {
+        std::printf("Failed to load %s\n", tmxFile.c_str());
+        return false;
+    }
+
+    Level level;
+    LoadLevel(map, level, Int2::zero);
+
+    std::string cacheFile = LevelCachePath(tmxFile.c_str());
+    if (!WriteLevelCache(level, tmxFile.c_str(), cacheFile.c_str())) {
+        std::printf("Failed to write %s\n", cacheFile.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::printf("%s -> %s (%ju bytes)\n", tmxFile.c_str(), cacheFile.c_str(),
+        (uintmax_t)std::filesystem::file_size(cacheFile, error));
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> inputs(argv + 1, argv + argc);
+    if (inputs.empty()) inputs.push_back("res/");
+
+    int failures = 0;
+    for (const std::string& input : inputs) {
+        if (!std::filesystem::is_directory(input)) {
+            if (!CompileLevel(input)) failures++;
+            continue;
+        }
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(input)) {
+            if (entry.path().extension() != ".tmx") continue;
+            // Keep the generic format so cached paths match how the game names its files
+            if (!CompileLevel(entry.path().generic_string())) failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}